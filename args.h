@@ -542,6 +542,10 @@ ArgDescriptor argDescriptors[] = {
   { "fontPieceSize", ArgInt, (void *) &appData.fontPieceSize, TRUE, (ArgIniType) 80 },
   { "overrideLineGap", ArgInt, (void *) &appData.overrideLineGap, TRUE, (ArgIniType) 1 },
   { "adjudicateLossThreshold", ArgInt, (void *) &appData.adjudicateLossThreshold, TRUE, (ArgIniType) 0 },
+  { "adjudicateLossPlies", ArgInt, (void *) &appData.adjudicateLossPlies, TRUE, (ArgIniType) 6 },
+  { "adjudicateDrawThreshold", ArgInt, (void *) &appData.adjudicateDrawThreshold, TRUE, (ArgIniType) 0 },
+  { "adjudicateDrawPlies", ArgInt, (void *) &appData.adjudicateDrawPlies, TRUE, (ArgIniType) 10 },
+  { "adjudicateDrawStart", ArgInt, (void *) &appData.adjudicateDrawStart, TRUE, (ArgIniType) 40 },
   { "delayBeforeQuit", ArgInt, (void *) &appData.delayBeforeQuit, TRUE, (ArgIniType) 0 },
   { "delayAfterQuit", ArgInt, (void *) &appData.delayAfterQuit, TRUE, (ArgIniType) 0 },
   { "nameOfDebugFile", ArgFilename, (void *) &appData.nameOfDebugFile, FALSE, (ArgIniType) DEBUG_FILE },
@@ -611,8 +615,20 @@ ArgDescriptor argDescriptors[] = {
   { "syncAfterCycle", ArgBoolean, (void *) &appData.cycleSync, FALSE, (ArgIniType) TRUE },
   { "seedBase", ArgInt, (void *) &appData.seedBase, FALSE, (ArgIniType) 1 },
   { "pgnNumberTag", ArgBoolean, (void *) &appData.numberTag, TRUE, (ArgIniType) FALSE },
+  { "pgnCpuTags", ArgBoolean, (void *) &appData.cpuTags, TRUE, (ArgIniType) FALSE },
+  { "latencyFile", ArgFilename, (void *) &appData.latencyFile, FALSE, (ArgIniType) "" },
+  { "standingsFile", ArgFilename, (void *) &appData.standingsFile, FALSE, (ArgIniType) "" },
+  { "matchLog", ArgFilename, (void *) &appData.matchLog, FALSE, (ArgIniType) "" },
+  { "sprt", ArgString, (void *) &appData.sprt, FALSE, (ArgIniType) "" },
+  { "openingSuite", ArgBoolean, (void *) &appData.openingSuite, FALSE, (ArgIniType) FALSE },
+  { "openingSeed", ArgInt, (void *) &appData.openingSeed, FALSE, (ArgIniType) 0 },
   { "afterGame", ArgString, (void *) &appData.afterGame, FALSE, INVALID },
   { "afterTourney", ArgString, (void *) &appData.afterTourney, FALSE, INVALID },
+  { "concurrency", ArgInt, (void *) &appData.concurrency, FALSE, (ArgIniType) 1 },
+  { "workerNr", ArgInt, (void *) &appData.workerNr, FALSE, (ArgIniType) 0 },
+  { "autoAffinity", ArgBoolean, (void *) &appData.autoAffinity, TRUE, (ArgIniType) FALSE },
+  { "nativeUCI", ArgBoolean, (void *) &appData.nativeUCI, TRUE, (ArgIniType) FALSE },
+  { "enginePool", ArgInt, (void *) &appData.enginePool, FALSE, (ArgIniType) 0 },
 
   /* [HGM] board-size, adjudication and misc. options */
   { "oneClickMove", ArgBoolean, (void *) &appData.oneClick, TRUE, (ArgIniType) FALSE },
@@ -633,6 +649,7 @@ ArgDescriptor argDescriptors[] = {
   { "checkMates", ArgBoolean, (void *) &appData.checkMates, TRUE, (ArgIniType) FALSE },
   { "materialDraws", ArgBoolean, (void *) &appData.materialDraws, TRUE, (ArgIniType) FALSE },
   { "trivialDraws", ArgBoolean, (void *) &appData.trivialDraws, TRUE, (ArgIniType) FALSE },
+  { "tablebaseAdjudication", ArgBoolean, (void *) &appData.tablebaseAdjudication, TRUE, (ArgIniType) FALSE },
   { "ruleMoves", ArgInt, (void *) &appData.ruleMoves, TRUE, (ArgIniType) 51 },
   { "repeatsToDraw", ArgInt, (void *) &appData.drawRepeats, TRUE, (ArgIniType) 6 },
   { "backgroundObserve", ArgBoolean, (void *) &appData.bgObserve, TRUE, (ArgIniType) FALSE },
@@ -744,6 +761,10 @@ ArgDescriptor argDescriptors[] = {
   { "secondAccumulateTC", ArgInt, (void *) &appData.secondAccumulateTC, FALSE, (ArgIniType) 1 },
   { "firstNPS", ArgInt, (void *) &appData.firstNPS, FALSE, (ArgIniType) -1 },
   { "secondNPS", ArgInt, (void *) &appData.secondNPS, FALSE, (ArgIniType) -1 },
+  { "firstAffinity", ArgString, (void *) &appData.firstAffinity, FALSE, (ArgIniType) "" },
+  { "secondAffinity", ArgString, (void *) &appData.secondAffinity, FALSE, (ArgIniType) "" },
+  { "fAffinity", ArgString, (void *) &appData.firstAffinity, FALSE, INVALID },
+  { "sAffinity", ArgString, (void *) &appData.secondAffinity, FALSE, INVALID },
   { "noGUI", ArgTrue, (void *) &appData.noGUI, FALSE, INVALID },
   { "keepLineBreaksICS", ArgBoolean, (void *) &appData.noJoin, TRUE, INVALID },
   { "wrapContinuationSequence", ArgString, (void *) &appData.wrapContSeq, FALSE, INVALID },
@@ -57,7 +57,12 @@
 
 int flock(int f, int code);
 #define LOCK_EX 2
+#define LOCK_UN 3
 #define SLASH '\\'
+#include <io.h>
+#define pread(fd, buf, n, off)  (lseek(fd, off, SEEK_SET) < 0 ? -1 : read(fd, buf, n))
+#define pwrite(fd, buf, n, off) (lseek(fd, off, SEEK_SET) < 0 ? -1 : write(fd, buf, n))
+#define ftruncate _chsize
 
 #else
 
@@ -131,6 +136,10 @@ extern int gettimeofday(struct timeval *, struct timezone *);
 #include "backendz.h"
 #include "evalgraph.h"
 #include "gettext.h"
+#if HAVE_FATHOM
+# include <stdint.h>
+# include <tbprobe.h>
+#endif
 
 #ifdef ENABLE_NLS
 # define _(s) gettext (s)
@@ -161,6 +170,9 @@ int AutoPlayOneMove P((void));
 int LoadGameOneMove P((ChessMove readAhead));
 int LoadGameFromFile P((char *filename, int n, char *title, int useList));
 int LoadPositionFromFile P((char *filename, int n, char *title));
+int LoadSuiteGame P((int e, char *title));
+int LoadSuitePosition P((int e, char *title));
+static int SetUpPosition P((Board initial_position, int positionNumber, char *title));
 int SavePositionToFile P((char *filename));
 void MakeMove P((int fromX, int fromY, int toX, int toY, int promoChar));
 void ShowMove P((int fromX, int fromY, int toX, int toY));
@@ -221,11 +233,18 @@ void NextMatchGame P((void));
 int NextTourneyGame P((int nr, int *swap));
 int Pairing P((int nr, int nPlayers, int *w, int *b, int *sync));
 FILE *WriteTourneyFile P((char *results, FILE *f));
+int CountPlayers P((char *p));
 void DisplayTwoMachinesTitle P(());
 static void ExcludeClick P((int index));
 void ToggleSecond P((void));
 void PauseEngine P((ChessProgramState *cps));
 static int NonStandardBoardSize P((void));
+void CacheCurrentMoves P((void));
+void PrepareSpare P((ChessProgramState *cps));
+void ReportLatency P((ChessProgramState *cps));
+static void EndLatency P((ChessProgramState *cps));
+static void AddLatency P((Latency *h, TimeMark *now, TimeMark *then));
+void KillSpares P((void));
 
 #ifdef WIN32
        extern void ConsoleCreate();
@@ -449,6 +468,7 @@ GameMode gameMode = BeginningOfGame;
 char moveList[MAX_MOVES][MOVE_LEN], parseList[MAX_MOVES][MOVE_LEN * 2];
 char *commentList[MAX_MOVES], *cmailCommentList[CMAIL_MAX_GAMES];
 ChessProgramStats_Move pvInfoList[MAX_MOVES]; /* [AS] Info about engine thinking */
+static u64 pvNodes[MAX_MOVES]; /* [HGM] log: nodes the engine reported for each move */
 int hiddenThinkOutputState = 0; /* [AS] */
 int adjudicateLossThreshold = 0; /* [AS] Automatic adjudication */
 int adjudicateLossPlies = 6;
@@ -465,6 +485,7 @@ Boolean adjustedClock;
 long timeControl_2; /* [AS] Allow separate time controls */
 char *fullTimeControlString = NULL, *nextSession, *whiteTC, *blackTC, activePartner; /* [HGM] secondary TC: merge of MPS, TC and inc */
 long timeRemaining[2][MAX_MOVES];
+static long clockStart, clockUsed[2]; // [HGM] log: clock of side to move when it started, and time charged to each side
 int matchGame = 0, nextGame = 0, roundNr = 0;
 Boolean waitingForGame = FALSE, startingEngine = FALSE;
 TimeMark programStartTime, pauseStart;
@@ -765,6 +786,8 @@ InitEngine (ChessProgramState *cps, int n)
     cps->maybeThinking = FALSE;
     cps->pr = NoProc;
     cps->isr = NULL;
+    cps->usageValid = 0;
+    cps->playerNr = -1;
     cps->sendTime = 2;
     cps->sendDrawOffers = 1;
 
@@ -777,6 +800,7 @@ InitEngine (ChessProgramState *cps, int n)
     cps->useSigterm = TRUE;
     cps->reuse = appData.reuse[n];
     cps->nps = appData.NPS[n];   // [HGM] nps: copy nodes per second
+    cps->affinity = appData.affinity[n];
     cps->useSetboard = FALSE;
     cps->useSAN = FALSE;
     cps->usePing = FALSE;
@@ -897,7 +921,7 @@ static char resetOptions[] =
 	"-reuse -firstIsUCI false -firstHasOwnBookUCI true -firstTimeOdds 1 "
 	"-firstInitString \"" INIT_STRING "\" -firstComputerString \"" COMPUTER_STRING "\" "
 	"-firstFeatures \"\" -firstLogo \"\" -firstAccumulateTC 1 "
-	"-firstOptions \"\" -firstNPS -1 -fn \"\" -firstScoreAbs false";
+	"-firstOptions \"\" -firstNPS -1 -fn \"\" -firstScoreAbs false -firstAffinity \"\"";
 
 void
 FloatToFront(char **list, char *engineLine)
@@ -1023,7 +1047,7 @@ InitBackEnd1 ()
     startVariant = StringToVariant(appData.variant); // [HGM] nicks: remember original variant
 
     GetTimeMark(&programStartTime);
-    srandom((programStartTime.ms + 1000*programStartTime.sec)*0x1001001); // [HGM] book: makes sure random is unpredictabe to msec level
+    srandom((programStartTime.us + 1000*programStartTime.sec + time(NULL))*0x1001001); // [HGM] book: makes sure random is unpredictabe to msec level
     appData.seedBase = random() + (random()<<15);
     pauseStart = programStartTime; pauseStart.sec -= 100; // [HGM] matchpause: fake a pause that has long since ended
 
@@ -1073,6 +1097,7 @@ InitBackEnd1 ()
 
     /* [AS] Adjudication threshold */
     adjudicateLossThreshold = appData.adjudicateLossThreshold;
+    if(appData.adjudicateLossPlies > 0) adjudicateLossPlies = appData.adjudicateLossPlies;
 
     InitEngine(&first, 0);
     InitEngine(&second, 1);
@@ -1364,6 +1389,10 @@ InitBackEnd2 ()
     ASSIGN(currentDebugFile, appData.nameOfDebugFile); // [HGM] debug split: remember initial name in use
 
     set_cont_sequence(appData.wrapContSeq);
+#if !HAVE_FATHOM
+    if (appData.tablebaseAdjudication) // [HGM] syzygy: do not let the user believe the tables are used
+	DisplayError(_("XBoard was built without the Fathom tablebase library,\nso tablebase adjudication is not available"), 0);
+#endif
     if (appData.matchGames > 0) {
 	appData.matchMode = TRUE;
     } else if (appData.matchMode) {
@@ -1397,20 +1426,107 @@ CalculateIndex (int index, int gameNr)
     return res;
 }
 
+/* [HGM] suite: with -openingSuite the game or position file of an auto-increment match is treated as an opening suite.
+ * It is indexed once, so that each game can be started from its opening without rescanning the file up to it, and
+ * without reading the file again for a position. Games are numbered as in the game list, and FEN lines as by
+ * LoadPosition (every line counts). With -openingSeed the order of the openings is shuffled by a permutation that
+ * only depends on the seed, so that all instances playing the same tourney agree on it. As the index is calculated
+ * from the game number, index -2 still plays each opening twice in a row, with reversed colors.
+ */
+
+typedef struct {
+    char *file;         // suite that was indexed, and how
+    int isGame, seed;
+    int n;              // nr of entries
+    int *order;         // entry (counting from 0) to use for each opening number, in shuffled order
+    long *offset;       // game suite: where each game starts in the file
+    FILE *f;            // game suite: the file, kept open for the next game
+    char **fen;         // position suite: every line of the file
+    char *text;         // position suite: the file contents these point into
+} Suite;
+
+static Suite suite;
+
+static unsigned int
+SuiteRandom (unsigned int *state)
+{   // xorshift; cannot use random(), as that is seeded differently in every instance
+    *state ^= *state << 13; *state ^= *state >> 17; *state ^= *state << 5;
+    return *state;
+}
+
+static int
+IndexSuite (char *file, int isGame)
+{   // record where every game is in the file, or read all positions, and shuffle the order if requested
+    FILE *f;
+    ListGame *lg;
+    int i, j, max = 0;
+    unsigned int state = appData.openingSeed;
+    long size;
+    char *p;
+
+    if(suite.file && !strcmp(suite.file, file) && suite.isGame == isGame && suite.seed == appData.openingSeed) return suite.n;
+    FREE(suite.order); FREE(suite.offset); FREE(suite.fen); FREE(suite.text);
+    suite.order = NULL; suite.offset = NULL; suite.fen = NULL; suite.text = NULL; suite.n = 0;
+    if(suite.f) fclose(suite.f), suite.f = NULL;
+    ASSIGN(suite.file, file); suite.isGame = isGame; suite.seed = appData.openingSeed;
+    if(!strcmp(file, "-") || (f = fopen(file, "rb")) == NULL) return 0;
+    if(isGame) { // use the game-list parser, so that games are numbered as everywhere else
+	if(!GameListBuild(f)) {
+	    for(lg = (ListGame *) gameList.head; lg->node.succ; lg = (ListGame *) lg->node.succ) suite.n++;
+	    suite.offset = (long *) malloc((suite.n + 1) * sizeof(long));
+	    for(i = 0, lg = (ListGame *) gameList.head; lg->node.succ; lg = (ListGame *) lg->node.succ) suite.offset[i++] = lg->offset;
+	}
+	GameListDestroy();
+	suite.f = f;
+    } else { // keep the whole file in memory, with a pointer to every line
+	if(fseek(f, 0, SEEK_END) || (size = ftell(f)) < 0 || fseek(f, 0, SEEK_SET) ||
+	   !(suite.text = malloc(size + 1)) || fread(suite.text, 1, size, f) != size) size = 0;
+	fclose(f);
+	if(suite.text) suite.text[size] = NULLCHAR;
+	p = suite.text;
+	// [HGM] as in LoadPosition: FEN can begin with digit, any piece letter valid in this variant, or a +
+	if(size && ((*p >= '0' && *p <= '9') || *p == '+' || CharToPiece(*p) != EmptySquare)) while(*p) {
+	    if(suite.n >= max) suite.fen = realloc(suite.fen, (max += 1000) * sizeof(char *));
+	    suite.fen[suite.n++] = p;
+	    if((p = strchr(p, '\n'))) *p++ = NULLCHAR; else break;
+	}
+    }
+    suite.order = (int *) malloc((suite.n + 1) * sizeof(int));
+    for(i=0; i<suite.n; i++) suite.order[i] = i;
+    if(appData.openingSeed) for(i=suite.n-1; i>0; i--) { // Fisher-Yates shuffle
+	j = SuiteRandom(&state) % (i + 1);
+	max = suite.order[i]; suite.order[i] = suite.order[j]; suite.order[j] = max;
+    }
+    if(appData.debugMode) fprintf(debugFP, "opening suite %s: %d entries\n", file, suite.n);
+    return suite.n;
+}
+
+static int
+SuiteEntry (char *file, int isGame, int index, int nr)
+{   // entry of the suite to start opening nr from, or -1 to load by number as usual
+    if(!appData.openingSuite || index >= 0 || nr > IndexSuite(file, isGame)) return -1; // beyond the end fails as before
+    return suite.order[nr - 1];
+}
+
+static int openingNr; // [HGM] log: number of the game or position the current game started from
+
 int
 LoadGameOrPosition (int gameNr)
 {   // [HGM] taken out of MatchEvent and NextMatchGame (to combine it)
+    openingNr = 0;
     if (*appData.loadGameFile != NULLCHAR) {
-	if (!LoadGameFromFile(appData.loadGameFile,
-		CalculateIndex(appData.loadGameIndex, gameNr),
-			      appData.loadGameFile, FALSE)) {
+	openingNr = CalculateIndex(appData.loadGameIndex, gameNr);
+	int e = SuiteEntry(appData.loadGameFile, TRUE, appData.loadGameIndex, openingNr);
+	if (!(e >= 0 ? LoadSuiteGame(e, appData.loadGameFile) :
+		       LoadGameFromFile(appData.loadGameFile, openingNr, appData.loadGameFile, FALSE))) {
 	    DisplayFatalError(_("Bad game file"), 0, 1);
 	    return 0;
 	}
     } else if (*appData.loadPositionFile != NULLCHAR) {
-	if (!LoadPositionFromFile(appData.loadPositionFile,
-		CalculateIndex(appData.loadPositionIndex, gameNr),
-				  appData.loadPositionFile)) {
+	openingNr = CalculateIndex(appData.loadPositionIndex, gameNr);
+	int e = SuiteEntry(appData.loadPositionFile, FALSE, appData.loadPositionIndex, openingNr);
+	if (!(e >= 0 ? LoadSuitePosition(e, appData.loadPositionFile) :
+		       LoadPositionFromFile(appData.loadPositionFile, openingNr, appData.loadPositionFile))) {
 	    DisplayFatalError(_("Bad position file"), 0, 1);
 	    return 0;
 	}
@@ -1418,14 +1534,149 @@ LoadGameOrPosition (int gameNr)
     return 1;
 }
 
-void
-ReserveGame (int gameNr, char resChar)
+/* [HGM] state: binary tourney state, kept next to the tourney file as <tourneyFile>.state.
+ * After a small header it holds one byte per game, with the same codes as the -results string,
+ * which are updated in place under a file lock. This way reserving a game or recording a result
+ * does not require re-parsing and rewriting the tourney file. To see the results of other instances we keep
+ * a copy of the game bytes, and on every lock only re-read those from the first game without a final result,
+ * which leaves the games still playing or not yet played. Once the state file exists it is
+ * authoritative; the -results string in the tourney file is brought up to date when we leave the tourney.
+ */
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+#define STATE_MAGIC 0x32544258 /* "XBT2" */
+#define MAX_WORKERS 64
+
+typedef struct {
+    int magic;
+    int next; // lowest game that might not be played or playing yet
+    int busyTime, timedGames;    // [HGM] dashboard: total duration (sec) of the games timed so far
+    int slotGame[MAX_WORKERS];   // game each worker is playing (+1), or 0 when idle
+    time_t slotStart[MAX_WORKERS];
+} StateHeader;
+
+static int stateFD = -1, settled, copyLen; // games before 'settled' in our copy have their final result
+static char *stateFile, *stateCopy;
+
+static int
+LockTourneyState (StateHeader *h)
+{   // open the binary state of the current tourney (creating it from the results string if needed), and lock it
+    char name[MSG_SIZ];
+    if(stateFD >= 0 && strcmp(stateFile, appData.tourneyFile)) close(stateFD), stateFD = -1; // tourney changed
+    if(stateFD < 0) {
+	snprintf(name, MSG_SIZ, "%s.state", appData.tourneyFile);
+	if((stateFD = open(name, O_RDWR | O_CREAT | O_BINARY, 0666)) < 0) return FALSE;
+	ASSIGN(stateFile, appData.tourneyFile);
+	settled = 0;
+    }
+    flock(stateFD, LOCK_EX);
+    if(pread(stateFD, h, sizeof(StateHeader), 0) != sizeof(StateHeader) || h->magic != STATE_MAGIC) { // new
+	int len = strlen(appData.results);
+	memset(h, 0, sizeof(StateHeader));
+	for(h->next = 0; h->next < len && appData.results[h->next] != ' '; h->next++);
+	h->magic = STATE_MAGIC;
+	settled = 0;
+	if(ftruncate(stateFD, sizeof(StateHeader)) || pwrite(stateFD, appData.results, len, sizeof(StateHeader)) != len) {
+	    flock(stateFD, LOCK_UN); close(stateFD); stateFD = -1;
+	    return FALSE;
+	}
+    }
+    return TRUE;
+}
+
+static void
+LoadResults ()
+{   // refresh our copy of the results from the state; only games that can still change have to be read
+    struct stat st;
+    int i, len;
+    if(!fstat(stateFD, &st) && (len = st.st_size - sizeof(StateHeader)) >= 0) {
+	if(!stateCopy || len > copyLen) stateCopy = realloc(stateCopy, (copyLen = len) + 2);
+	if(settled > len) settled = len; // cannot happen, unless the file was truncated behind our back
+	if((i = pread(stateFD, stateCopy + settled, len - settled, sizeof(StateHeader) + settled)) < 0) i = 0;
+	len = settled + i;
+	for(i=settled; i<len; i++) if(stateCopy[i] == NULLCHAR) stateCopy[i] = ' '; // hole
+	stateCopy[len] = NULLCHAR;
+	while(settled < len && stateCopy[settled] != ' ' && stateCopy[settled] != '*') settled++;
+	ASSIGN(appData.results, stateCopy);
+    }
+}
+
+static void
+UnlockTourneyState (StateHeader *h)
+{   // write back header, refresh the results, and release the lock
+    pwrite(stateFD, h, sizeof(StateHeader), 0);
+    LoadResults();
+    flock(stateFD, LOCK_UN);
+}
+
+static char
+GameSlot (int gameNr, int newValue)
+{   // read (newValue < 0) or write the state of a single game; only call this while holding the lock
+    char c = newValue;
+    if(newValue >= 0) return pwrite(stateFD, &c, 1, sizeof(StateHeader) + gameNr) == 1 ? c : NULLCHAR;
+    return pread(stateFD, &c, 1, sizeof(StateHeader) + gameNr) == 1 ? c : NULLCHAR; // NULLCHAR beyond end
+}
+
+static void
+ReadTourneyState ()
+{   // replace results string (as it was just parsed from the tourney file) by the up-to-date one
+    StateHeader h;
+    if(LockTourneyState(&h)) UnlockTourneyState(&h);
+}
+
+static int
+PairsFile ()
+{   // [HGM] standings: file with the players of each Swiss game, as these cannot be derived from the game number
+    static char *name;
+    static int fd = -1;
+    char buf[MSG_SIZ];
+    if(fd >= 0 && strcmp(name, appData.tourneyFile)) close(fd), fd = -1; // tourney changed
+    if(fd < 0) {
+	snprintf(buf, MSG_SIZ, "%s.pairs", appData.tourneyFile);
+	if((fd = open(buf, O_RDWR | O_CREAT | O_BINARY, 0666)) >= 0) { ASSIGN(name, appData.tourneyFile); }
+    }
+    return fd;
+}
+
+static void
+StorePairing (int nr, int w, int b)
 {
-    FILE *tf = fopen(appData.tourneyFile, "r+");
-    char *p, *q, c, buf[MSG_SIZ];
-    if(tf == NULL) { nextGame = appData.matchGames + 1; return; } // kludge to terminate match
-    safeStrCpy(buf, lastMsg, MSG_SIZ);
-    DisplayMessage(_("Pick new game"), "");
+    int fd = PairsFile(), rec[2];
+    rec[0] = w + 1; rec[1] = b + 1; // 0 means unknown
+    if(fd >= 0) pwrite(fd, rec, sizeof(rec), nr*sizeof(rec));
+}
+
+static int
+StoredPairing (int nr, int *w, int *b)
+{
+    int fd = PairsFile(), rec[2];
+    if(fd < 0 || pread(fd, rec, sizeof(rec), nr*sizeof(rec)) != sizeof(rec) || !rec[0] || !rec[1]) return FALSE;
+    *w = rec[0] - 1; *b = rec[1] - 1;
+    return TRUE;
+}
+
+static void
+SyncTourneyFile ()
+{   // copy the game states back into the results string of the tourney file, for those who read it there
+    FILE *f = fopen(appData.tourneyFile, "r+");
+    if(f == NULL) return;
+    flock(fileno(f), LOCK_EX);
+    ParseArgsFromFile(f);
+    ReadTourneyState();
+    fseek(f, 0, SEEK_SET);
+    WriteTourneyFile(appData.results, f);
+    fclose(f); // releases lock
+}
+
+static void
+ReserveGameInFile (int gameNr, char resChar)
+{   // record result and reserve next game by rewriting the results string in the (locked) tourney file itself
+    FILE *tf;
+    char *p, *q, c;
+
+    if((tf = fopen(appData.tourneyFile, "r+")) == NULL) { nextGame = appData.matchGames + 1; return; } // kludge to terminate match
     flock(fileno(tf), LOCK_EX); // lock the tourney file while we are messing with it
     ParseArgsFromFile(tf);
     p = q = appData.results;
@@ -1451,8 +1702,44 @@ ReserveGame (int gameNr, char resChar)
 	 fseek(tf, -(strlen(p)+2), SEEK_END);
     else fseek(tf, -(strlen(p)+3), SEEK_END);
     fprintf(tf, "%s\"\n", q); fclose(tf); // update, and flush by closing
-    DisplayMessage(buf, "");
     free(p); appData.results = q;
+}
+
+void
+ReserveGame (int gameNr, char resChar)
+{
+    char c, buf[MSG_SIZ];
+    StateHeader h;
+
+    safeStrCpy(buf, lastMsg, MSG_SIZ);
+    DisplayMessage(_("Pick new game"), "");
+    if(LockTourneyState(&h)) { // [HGM] state: record result and reserve next game in the state file
+	static int slot = -1; // [HGM] dashboard: slot in the state header this instance claimed
+	time_t now = time(NULL);
+	if(gameNr < 0) slot = -1; // (re)starting tourney
+	if(gameNr >= 0) {
+	    GameSlot(gameNr, resChar);
+	    if(resChar == ' ' && gameNr < h.next) h.next = gameNr; // game became available again
+	    else if(slot >= 0 && h.slotGame[slot] == gameNr + 1) h.busyTime += now - h.slotStart[slot], h.timedGames++;
+	}
+	for(nextGame = h.next; (c = GameSlot(nextGame, -1)) && c != ' '; nextGame++); // skip games played or playing
+	h.next = nextGame;
+	if(slot >= 0 && h.slotGame[slot] == gameNr + 1) h.slotGame[slot] = 0; // release it
+	slot = -1;
+	if(nextGame <= appData.matchGames && resChar != ' ' && !abortMatch) { // reserve it
+	    GameSlot(nextGame, '*');
+	    for(slot=0; slot<MAX_WORKERS; slot++) // claim a free slot; that of an instance that died counts as free
+		if(!h.slotGame[slot] || GameSlot(h.slotGame[slot] - 1, -1) != '*') break;
+	    if(slot < MAX_WORKERS) h.slotGame[slot] = nextGame + 1, h.slotStart[slot] = now; else slot = -1;
+	}
+	UnlockTourneyState(&h);
+	if(appData.debugMode) fprintf(debugFP, "state '%s': next %d\n", appData.results, nextGame);
+	if(nextGame > appData.matchGames || resChar == ' ' || abortMatch) SyncTourneyFile(); // we leave the tourney
+	DisplayMessage(buf, "");
+    } else { // no state file could be made: fall back on the tourney file
+	ReserveGameInFile(gameNr, resChar);
+	DisplayMessage(buf, "");
+    }
     if(nextGame <= appData.matchGames && resChar != ' ' && !abortMatch &&
        (gameNr < 0 || nextGame / appData.defaultMatchGames != gameNr / appData.defaultMatchGames)) {
       int round = appData.defaultMatchGames * appData.tourneyType;
@@ -1462,6 +1749,118 @@ ReserveGame (int gameNr, char resChar)
 	UnloadEngine(&second); // already unload the engines, so TwoMachinesEvent will load new ones.
     }
     if(appData.debugMode) fprintf(debugFP, "Reserved, next=%d, nr=%d\n", nextGame, gameNr);
+    TourneyDashboardUpdate(); // [HGM] dashboard: slot status changed
+}
+
+ProcRef workerPR[MAX_WORKERS];
+InputSourceRef workerISR[MAX_WORKERS];
+int nrOfWorkers, exitStatus = -1; // exit status of an ExitEvent() deferred until the helpers are done
+
+int
+HelpersBusy ()
+{
+    int i, n = 0;
+    for(i=1; i<=nrOfWorkers; i++) n += (workerPR[i] != NoProc);
+    return n;
+}
+
+void
+WorkerOutput (InputSourceRef isr, VOIDSTAR closure, char *message, int count, int error)
+{   // [HGM] concurrency: helpers play without board window, so all they print is log material
+    int n = (ProcRef *) closure - workerPR;
+
+    if(count <= 0) { // helper quit (tourney done, or killed)
+	RemoveInputSource(isr); workerISR[n] = NULL;
+	DestroyChildProcess(workerPR[n], 0); workerPR[n] = NoProc;
+	if(exitStatus >= 0 && !HelpersBusy()) ExitEvent(exitStatus); // the last one we were waiting for
+	return;
+    }
+    if(appData.debugMode) fprintf(debugFP, "helper %d: %.*s", n, count, message);
+}
+
+void
+StartWorkers ()
+{   // [HGM] concurrency: start display-less copies of ourselves on the same tourney file, to play the other games in parallel.
+    // They pick their games through ReserveGame, and write results under the file lock, just like instances started by hand.
+    char buf[MSG_SIZ];
+    int i;
+
+    if(appData.concurrency <= 1 || nrOfWorkers || !appData.tourneyFile[0]) return;
+    if(appData.workerNr) return; // we are a helper ourselves
+    for(i=1; i<appData.concurrency && i<MAX_WORKERS; i++) {
+	snprintf(buf, MSG_SIZ, "\"%s\" -tf \"%s\" -mm -noGUI -xexit -concurrency %d -workerNr %d -saveSettingsOnExit false",
+		HelperProgram(), appData.tourneyFile, appData.concurrency, i);
+	if(StartChildProcess(buf, "", &workerPR[i])) { workerPR[i] = NoProc; break; }
+	workerISR[i] = AddInputSource(workerPR[i], TRUE, WorkerOutput, (VOIDSTAR) &workerPR[i]);
+	nrOfWorkers = i;
+    }
+}
+
+void
+StopWorkers ()
+{   // [HGM] concurrency: abort the games of the helpers still running. Interrupt them all before waiting for
+    // any, so they shut down in parallel; their ExitEvent() unreserves the games, for a later session to play.
+    int i;
+
+    for(i=1; i<=nrOfWorkers; i++) {
+	if(workerISR[i]) RemoveInputSource(workerISR[i]), workerISR[i] = NULL;
+	if(workerPR[i] != NoProc) InterruptChildProcess(workerPR[i]);
+    }
+    for(i=1; i<=nrOfWorkers; i++)
+	if(workerPR[i] != NoProc) DestroyChildProcess(workerPR[i], 10), workerPR[i] = NoProc;
+    nrOfWorkers = 0;
+}
+
+/* [HGM] sprt: sequential probability ratio test on the match score of the first engine, to end a regression
+ * test as soon as it is conclusive. When the games are played in pairs from the same opening, the pairs are
+ * treated as the samples (pentanomial), which accounts for the correlation between the two games.
+ */
+
+static int sprtGames[3], sprtPairs[5], sprtFirstOfPair = -1; // W/D/L of first engine, pairs by total half points
+static char sprtVerdict[MSG_SIZ];
+
+static double
+LLR (int *count, int n, double s0, double s1)
+{   // log-likelihood ratio for outcome k = 0..n-1 scoring k/(n-1), in normal approximation
+    int k, N = 0;
+    double x, mean = 0, var = 0;
+    for(k=0; k<n; k++) N += count[k], mean += count[k] * k/(n-1.);
+    if(N == 0) return 0;
+    mean /= N;
+    for(k=0; k<n; k++) x = k/(n-1.) - mean, var += count[k] * x*x;
+    if((var /= N) <= 0) return 0;
+    return N * (s1 - s0) * (2*mean - s0 - s1) / (2*var);
+}
+
+static int
+SPRT (ChessMove result)
+{   // account game result; return TRUE (with the verdict in sprtVerdict) when a bound is crossed
+    float elo0, elo1, alpha = 0.05, beta = 0.05;
+    double s0, s1, llr, lower, upper;
+    int score, paired;
+
+    if(!appData.sprt || sscanf(appData.sprt, "%f %f %f %f", &elo0, &elo1, &alpha, &beta) < 2) return FALSE;
+    switch(result) {
+      case WhiteWins:   score = first.twoMachinesColor[0] == 'w' ? 2 : 0; break;
+      case BlackWins:   score = first.twoMachinesColor[0] == 'b' ? 2 : 0; break;
+      case GameIsDrawn: score = 1; break;
+      default: return FALSE; // unfinished games will be replayed
+    }
+    sprtGames[score]++;
+    paired = (*appData.loadGameFile && appData.loadGameIndex == -2) || (*appData.loadPositionFile && appData.loadPositionIndex == -2);
+    s0 = 1/(1 + pow(10., -elo0/400.)); s1 = 1/(1 + pow(10., -elo1/400.));
+    if(paired) {
+	if(matchGame & 1) { sprtFirstOfPair = score; return FALSE; } // second game of pair still to come
+	if(sprtFirstOfPair < 0) return FALSE;
+	sprtPairs[sprtFirstOfPair + score]++; sprtFirstOfPair = -1;
+	llr = LLR(sprtPairs, 5, s0, s1);
+    } else llr = LLR(sprtGames, 3, s0, s1);
+    lower = log(beta/(1 - alpha)); upper = log((1 - beta)/alpha);
+    if(appData.debugMode)
+	fprintf(debugFP, "SPRT: +%d =%d -%d, LLR = %.3f (%.3f, %.3f)\n", sprtGames[2], sprtGames[1], sprtGames[0], llr, lower, upper);
+    if(llr > lower && llr < upper) return FALSE;
+    snprintf(sprtVerdict, MSG_SIZ, _("\nSPRT [%g, %g]: H%d accepted, LLR = %.2f"), elo0, elo1, llr >= upper, llr);
+    return TRUE;
 }
 
 void
@@ -1481,6 +1880,8 @@ MatchEvent (int mode)
 	if(mode == 2) appData.matchGames = appData.defaultMatchGames;
 	/* Set up machine vs. machine match */
 	nextGame = 0;
+	memset(sprtGames, 0, sizeof(sprtGames)); memset(sprtPairs, 0, sizeof(sprtPairs)); // [HGM] sprt
+	sprtFirstOfPair = -1; sprtVerdict[0] = NULLCHAR;
 	NextTourneyGame(-1, &dummy); // sets appData.matchGames if this is tourney, to make sure ReserveGame knows it
 	if(appData.tourneyFile[0]) {
 	    ReserveGame(-1, 0);
@@ -1515,6 +1916,7 @@ MatchEvent (int mode)
 	matchMode = mode;
 	matchGame = roundNr = 1;
 	first.matchWins = second.matchWins = 0; // [HGM] match: needed in later matches
+	StartWorkers(); // [HGM] concurrency: after our own reservation, so the helpers start on the next games
 	NextMatchGame();
 }
 
@@ -4748,7 +5150,7 @@ ParseBoard12 (char *string)
 				     PosFlags(moveNum - 1),
 				     fromY, fromX, toY, toX, promoChar,
 				     parseList[moveNum-1]);
-            switch (MateTest(boards[moveNum], PosFlags(moveNum)) ) {
+            switch (CheckMateTest(boards[moveNum], PosFlags(moveNum)) ) {
 	      case MT_NONE:
 	      case MT_STALEMATE:
 	      default:
@@ -6041,6 +6443,7 @@ InitPosition (int redraw)
     if(gameInfo.holdingsSize) gameInfo.holdingsWidth = 2;
     if(BOARD_HEIGHT > BOARD_RANKS || BOARD_WIDTH > BOARD_FILES)
         DisplayFatalError(_("Recompile to support this BOARD_RANKS or BOARD_FILES!"), 0, 2);
+    InitMoveTables(); // [HGM] speed: compile how the pieces move in this variant
 
     pawnRow = gameInfo.boardHeight - 7; /* seems to work in all common variants */
     if(pawnRow < 1) pawnRow = 1;
@@ -6444,6 +6847,7 @@ HasPromotionChoice (int fromX, int fromY, int toX, int toY, char *promoChoice, i
     premove = gameMode == IcsPlayingWhite && !WhiteOnMove(currentMove) ||
 	      gameMode == IcsPlayingBlack &&  WhiteOnMove(currentMove);
     if(appData.testLegality && !premove) {
+	CacheCurrentMoves();
 	moveType = LegalityTest(boards[currentMove], PosFlags(currentMove),
 			fromY, fromX, toY, toX, gameInfo.variant == VariantShogi ? '+' : NULLCHAR);
 	if(moveType != WhitePromotion && moveType  != BlackPromotion)
@@ -6571,6 +6975,12 @@ OKToStartUserMove (int x, int y)
     return TRUE;
 }
 
+void
+CacheCurrentMoves ()
+{   // [HGM] speed: generate the legal moves of the displayed position only once; the user-move code replays them from the cache
+    if(appData.testLegality) CacheLegalMoves(boards[currentMove], PosFlags(currentMove), currentMove);
+}
+
 Boolean
 OnlyMove (int *x, int *y, Boolean captures)
 {
@@ -6591,6 +7001,7 @@ OnlyMove (int *x, int *y, Boolean captures)
       default:
 	return FALSE;
     }
+    CacheCurrentMoves();
     cl.pieceIn = EmptySquare;
     cl.rfIn = *y;
     cl.ffIn = *x;
@@ -6795,6 +7206,7 @@ UserMoveEvent(int fromX, int fromY, int toX, int toY, int promoChar)
     }
 
     /* [HGM] always test for legality, to get promotion info */
+    CacheCurrentMoves();
     moveType = LegalityTest(boards[currentMove], PosFlags(currentMove),
                                          fromY, fromX, toY, toX, promoChar);
 
@@ -6947,6 +7359,8 @@ FinishMove (ChessMove moveType, int fromX, int fromY, int toX, int toY, int prom
 	 // [HGM] book: if program might be playing, let it use book
 	bookHit = SendMoveToBookUser(forwardMostMove-1, &first, FALSE);
 	first.maybeThinking = TRUE;
+	if(!bookHit && (gameMode == MachinePlaysWhite || gameMode == MachinePlaysBlack))
+	    GetTimeMark(&first.moveSent), first.moveTimed = TRUE; // [HGM] latency
     } else if(fromY == DROP_RANK && fromX == EmptySquare) {
 	if(!first.useSetboard) SendToProgram("undo\n", &first); // kludge to change stm in engines that do not support setboard
 	SendBoard(&first, currentMove+1);
@@ -7035,6 +7449,7 @@ MarkTargetSquares (int clear)
      !appData.testLegality || gameMode == EditPosition) return;
   if(!clear) {
     int capt = 0;
+    CacheCurrentMoves();
     GenLegal(boards[currentMove], PosFlags(currentMove), Mark, (void*) marker, EmptySquare);
     if(PosFlags(0) & F_MANDATORY_CAPTURE) {
       for(x=0; x<BOARD_WIDTH; x++) for(y=0; y<BOARD_HEIGHT; y++) if(marker[y][x]>1) capt++;
@@ -7529,49 +7944,336 @@ ClearEngineOutputPane (int which)
     SetProgramStats( &dummyStats );
 }
 
-#define MAXPLAYERS 500
+/* [HGM] standings: running tourney standings. Results are accounted incrementally, by comparing the results
+ * string against the copy that was accounted before, and updating scores and the head-to-head cross-table
+ * for the games that changed. Sonneborn-Berger and ratings are derived from the cross-table when needed;
+ * the ratings are maximum-likelihood (logistic) estimates in the Ordo style, with a BayesElo-like prior of
+ * a draw against an average opponent to keep perfect scores finite, refined starting from the previous ones.
+ */
+
+#define ELO_PRIOR 2    /* nr of virtual draws against the field                          */
+#define LOG10E400 173.7178 /* 400/ln(10): rating points per unit of logistic scale          */
+
+typedef struct {
+    int nPlayers;      // size of all per-player arrays
+    int nCounted;      // length of 'counted'
+    char *counted;     // results string as accounted so far
+    int *points, *games;              // half points and games per player
+    int *cross, *crossGames;          // nPlayers x nPlayers: half points / games of row player against column player
+    float *elo, *eloError;
+    ProcUsage *usage;  // [HGM] cpu: totals over the tourney games played by this instance
+    int *timed;
+} Standings;
+
+static Standings standings;
+
+static void
+SizeStandings (int n)
+{   // (re)allocate for n players, and forget everything accounted so far
+    Standings *s = &standings;
+    if(n != s->nPlayers) {
+	FREE(s->points); FREE(s->games); FREE(s->cross); FREE(s->crossGames);
+	FREE(s->elo); FREE(s->eloError); FREE(s->usage); FREE(s->timed);
+	s->points = calloc(n, sizeof(int)); s->games = calloc(n, sizeof(int));
+	s->cross = calloc(n*n, sizeof(int)); s->crossGames = calloc(n*n, sizeof(int));
+	s->elo = calloc(n, sizeof(float)); s->eloError = calloc(n, sizeof(float));
+	s->usage = calloc(n, sizeof(ProcUsage)); s->timed = calloc(n, sizeof(int));
+	s->nPlayers = n;
+    } else {
+	memset(s->points, 0, n*sizeof(int)); memset(s->games, 0, n*sizeof(int));
+	memset(s->cross, 0, n*n*sizeof(int)); memset(s->crossGames, 0, n*n*sizeof(int));
+	memset(s->elo, 0, n*sizeof(float));
+    }
+    FREE(s->counted); s->counted = NULL; s->nCounted = 0;
+}
+
+static int
+GamePlayers (int nr, int nPlayers, int *w, int *b)
+{   // determine who had white and black in game nr of the tourney; returns FALSE if unknown
+    int color, dummy, savedMatchGame = matchGame, savedRoundNr = roundNr, savedMatchGames = appData.matchGames;
+    if(appData.tourneyType < 0) return StoredPairing(nr, w, b); // Swiss: as it was received from pairing engine
+    color = Pairing(nr, nPlayers, w, b, &dummy);
+    if(!(color ^ (matchGame & 1))) { dummy = *w; *w = *b; *b = dummy; }
+    matchGame = savedMatchGame; roundNr = savedRoundNr; appData.matchGames = savedMatchGames; // Pairing() alters these
+    return *w >= 0 && *b >= 0 && *w < nPlayers && *b < nPlayers && *w != *b;
+}
+
+static void
+AccountGame (int nr, char result, int sign)
+{   // add (sign=1) or remove (sign=-1) the result of a single game
+    Standings *s = &standings;
+    int w, b, wScore;
+    switch(result) {
+      case '+': wScore = 2; break;
+      case '-': wScore = 0; break;
+      case '=': wScore = 1; break;
+      default: return; // not finished
+    }
+    if(!GamePlayers(nr, s->nPlayers, &w, &b)) return;
+    s->points[w] += sign*wScore; s->points[b] += sign*(2 - wScore);
+    s->games[w] += sign; s->games[b] += sign;
+    s->cross[w*s->nPlayers + b] += sign*wScore; s->cross[b*s->nPlayers + w] += sign*(2 - wScore);
+    s->crossGames[w*s->nPlayers + b] += sign; s->crossGames[b*s->nPlayers + w] += sign;
+}
+
+static void
+UpdateStandings ()
+{   // account the games that changed since last time
+    Standings *s = &standings;
+    int i, n = CountPlayers(appData.participants), len = strlen(appData.results);
+    if(n != s->nPlayers || !s->counted) SizeStandings(n);
+    if(len > s->nCounted) {
+	s->counted = realloc(s->counted, len + 1);
+	memset(s->counted + s->nCounted, ' ', len - s->nCounted);
+	s->nCounted = len; s->counted[len] = NULLCHAR;
+    }
+    for(i=0; i<len; i++) if(s->counted[i] != appData.results[i]) { // only changed games cost anything
+	AccountGame(i, s->counted[i], -1);
+	AccountGame(i, s->counted[i] = appData.results[i], 1);
+    }
+}
+
+static void
+UpdateRatings ()
+{   // a few Newton sweeps from the previous ratings, then center the average at 0
+    Standings *s = &standings;
+    int i, j, k, n = s->nPlayers;
+    float mean;
+    for(k=0; k<20; k++) {
+	float change = 0;
+	for(i=0; i<n; i++) {
+	    double g = s->points[i]/2. + ELO_PRIOR/2., h = 0, p, step;
+	    p = 1/(1 + exp(s->elo[i]/LOG10E400)); // vs field, at rating 0
+	    g -= ELO_PRIOR*(1 - p); h += ELO_PRIOR*p*(1 - p);
+	    for(j=0; j<n; j++) if(s->crossGames[i*n + j]) {
+		p = 1/(1 + exp((s->elo[j] - s->elo[i])/LOG10E400));
+		g -= s->crossGames[i*n + j]*p; h += s->crossGames[i*n + j]*p*(1 - p);
+	    }
+	    step = LOG10E400*g/h;
+	    if(step > 200) step = 200;
+	    if(step < -200) step = -200;
+	    s->elo[i] += step; change += fabs(step);
+	    s->eloError[i] = 1.96*LOG10E400/sqrt(h); // 95% confidence
+	}
+	if(change < 0.1*n) break;
+    }
+    for(i=0, mean=0; i<n; i++) mean += s->elo[i];
+    for(i=0, mean/=n; i<n; i++) s->elo[i] -= mean;
+}
+
+static int
+SonnebornBerger (int i)
+{   // in quarter points
+    int j, sb = 0, n = standings.nPlayers;
+    for(j=0; j<n; j++) sb += standings.cross[i*n + j] * standings.points[j];
+    return sb;
+}
+
+static int
+CompareStandings (const void *a, const void *b)
+{
+    int i = *(int *)a, j = *(int *)b;
+    if(standings.points[i] != standings.points[j]) return standings.points[j] - standings.points[i];
+    if(SonnebornBerger(i) != SonnebornBerger(j)) return SonnebornBerger(j) - SonnebornBerger(i);
+    return i - j;
+}
+
+char *
+StandingsText (int display, int crossTable)
+{   // ranking (display lines at most), optionally followed by the cross-table of all players
+    Standings *s = &standings;
+    int i, j, w, n, *ranking, len = 0, size;
+    char *p, *q, **names;
+
+    UpdateStandings(); UpdateRatings();
+    n = s->nPlayers;
+    ranking = malloc(n*sizeof(int)); names = malloc((n+1)*sizeof(char*));
+    names[0] = p = strdup(appData.participants);
+    for(i=0; (p = strchr(p, '\n')) && i<n; ) *p++ = NULLCHAR, names[++i] = p;
+    for(i=0; i<n; i++) ranking[i] = i;
+    qsort(ranking, n, sizeof(int), CompareStandings);
+    size = n*120 + (crossTable ? (n+1)*(n*9 + 40) : 0) + 1;
+    q = p = malloc(size); *p = NULLCHAR;
+    for(w=j=0; w<n && j<display; w++) {
+	ProcUsage *u = s->usage + (i = ranking[w]);
+	if(appData.tourneyType > 0 && i >= appData.tourneyType) continue; // in gauntlet, list only gauntlet engine(s)
+	q += sprintf(q, "%2d. %5.1f/%-3d %-19.19s %5.0f +-%-4.0f SB %.2f", j+1, s->points[i]/2., s->games[i], names[i],
+		     s->elo[i], s->eloError[i], SonnebornBerger(i)/4.);
+	if(s->timed[i]) // [HGM] cpu: average CPU per game and largest memory footprint, to spot engines that hog the machine
+	    q += sprintf(q, " %6.1fs/game %5ldMB", (u->userTime + u->sysTime)/(1000.*s->timed[i]), u->maxRSS/1024);
+	*q++ = '\n'; *q = NULLCHAR; j++;
+    }
+    if(crossTable) {
+	q += sprintf(q, "\n%-24s", "");
+	for(w=0; w<n; w++) q += sprintf(q, "%3d     ", w+1);
+	for(w=0; w<n; w++) {
+	    q += sprintf(q, "\n%2d. %-19.19s ", w+1, names[i = ranking[w]]);
+	    for(len=0; len<n; len++) {
+		j = ranking[len];
+		if(i == j) q += sprintf(q, "%3s     ", "x"); else
+		if(!s->crossGames[i*n + j]) q += sprintf(q, "%3s     ", "."); else
+		q += sprintf(q, "%4.1f/%-2d ", s->cross[i*n + j]/2., s->crossGames[i*n + j]);
+	    }
+	}
+	*q++ = '\n'; *q = NULLCHAR;
+    }
+    free(names[0]); free(names); free(ranking);
+    return p;
+}
+
+static void
+WriteStandings ()
+{   // [HGM] standings: full standings and cross-table on -standingsFile, rewritten after every game
+    FILE *f;
+    char *text;
+    if(!appData.standingsFile || !*appData.standingsFile || (f = fopen(appData.standingsFile, "w")) == NULL) return;
+    text = StandingsText(1000000, TRUE);
+    fprintf(f, "%s\n%s", appData.tourneyFile, text);
+    fclose(f); free(text);
+}
+
+static char *
+LogString (char *q, char *s, int json)
+{   // quoted string field; quotes are escaped and control characters dropped
+    *q++ = '"';
+    while(s && *s) {
+	if(*s == '"') *q++ = (json ? '\\' : '"'); else
+	if(json && *s == '\\') *q++ = '\\'; else
+	if((unsigned char) *s < ' ') { s++; continue; }
+	*q++ = *s++;
+    }
+    *q++ = '"';
+    return q;
+}
+
+static void
+LogMatchGame (int nr, ChessMove result)
+{   // [HGM] log: append a record describing the game that just ended to -matchLog, in one write
+    static char *names[] = { "game", "white", "black", "first", "opening", "result", "reason", "plies",
+			     "whiteTime", "blackTime", "whiteDepth", "blackDepth", "whiteNps", "blackNps", NULL };
+    char *buf, *q, *ext;
+    double time[2] = { 0, 0 }, nodes[2] = { 0, 0 }, nodeTime[2] = { 0, 0 };
+    int i, fd, json, depth[2] = { 0, 0 }, moves[2] = { 0, 0 }, len;
+
+    if(!appData.matchLog || !*appData.matchLog) return;
+    ext = strrchr(appData.matchLog, '.');
+    json = ext && (!strcmp(ext, ".json") || !strcmp(ext, ".jsonl"));
+    if((fd = open(appData.matchLog, O_WRONLY | O_APPEND | O_CREAT | O_BINARY, 0666)) < 0) return;
+
+    time[0] = clockUsed[0] / 1000.; time[1] = clockUsed[1] / 1000.; // as charged by the clocks, for all moves
+    for(i=backwardMostMove; i<forwardMostMove; i++) { // per-side totals of the engine info stored with the moves
+	int s = !WhiteOnMove(i);
+	if(pvInfoList[i].depth <= 0) continue; // book move, or no info
+	depth[s] += pvInfoList[i].depth; moves[s]++;
+	if(pvNodes[i] && pvInfoList[i].time > 0) nodes[s] += pvNodes[i], nodeTime[s] += pvInfoList[i].time / 100.;
+    }
+
+    len = strlen(gameInfo.white ? gameInfo.white : "") + strlen(gameInfo.black ? gameInfo.black : "")
+	+ strlen(gameInfo.resultDetails ? gameInfo.resultDetails : "");
+    q = buf = malloc(2*len + 2*MSG_SIZ);
+    if(!json && lseek(fd, 0, SEEK_END) == 0) { // new CSV file: start with header
+	for(i=0; names[i]; i++) q += sprintf(q, "%s%s", i ? "," : "", names[i]);
+	*q++ = '\n';
+    }
+    for(i=0; names[i]; i++) {
+	if(i) *q++ = ','; else if(json) *q++ = '{';
+	if(json) q += sprintf(q, "\"%s\":", names[i]);
+	switch(i) {
+	  case 0: q += sprintf(q, "%d", nr); break;
+	  case 1: q = LogString(q, gameInfo.white, json); break;
+	  case 2: q = LogString(q, gameInfo.black, json); break;
+	  case 3: q = LogString(q, first.twoMachinesColor[0] == 'w' ? "w" : "b", json); break;
+	  case 4: q += sprintf(q, "%d", openingNr); break;
+	  case 5: q = LogString(q, PGNResult(result), json); break;
+	  case 6: q = LogString(q, gameInfo.resultDetails, json); break;
+	  case 7: q += sprintf(q, "%d", forwardMostMove - backwardMostMove); break;
+	  case 8: case 9: q += sprintf(q, "%.2f", time[i-8]); break;
+	  case 10: case 11: q += sprintf(q, "%.1f", moves[i-10] ? depth[i-10] / (double) moves[i-10] : 0.); break;
+	  case 12: case 13: q += sprintf(q, "%.0f", nodeTime[i-12] > 0 ? nodes[i-12] / nodeTime[i-12] : 0.); break;
+	}
+    }
+    if(json) *q++ = '}';
+    *q++ = '\n';
+    if(write(fd, buf, q - buf) != q - buf && appData.debugMode) fprintf(debugFP, "match log: write failed\n");
+    close(fd); free(buf);
+}
 
 char *
 TourneyStandings (int display)
 {
-    int i, w, b, color, wScore, bScore, dummy, nr=0, nPlayers=0;
-    int score[MAXPLAYERS], ranking[MAXPLAYERS], points[MAXPLAYERS], games[MAXPLAYERS];
-    char result, *p, *names[MAXPLAYERS];
+    if(strchr(appData.results, '*') || (appData.tourneyType >= 0 && strchr(appData.results, ' ')))
+	return strdup("busy"); // tourney not finished (in Swiss unplayed games are not pre-allocated)
+    return StandingsText(display, FALSE);
+}
 
-    if(appData.tourneyType < 0 && !strchr(appData.results, '*'))
-	return strdup(_("Swiss tourney finished")); // standings of Swiss yet TODO
-    names[0] = p = strdup(appData.participants);
-    while(p = strchr(p, '\n')) *p++ = NULLCHAR, names[++nPlayers] = p; // count participants
+static char *
+PlayerName (int nr, char *buf)
+{   // name of participant nr, truncated to fit a table column
+    char *p = appData.participants;
+    int len;
+    if(nr < 0) return strcpy(buf, "?");
+    for(; nr > 0 && p; nr--) if((p = strchr(p, '\n'))) p++;
+    if(!p || !*p) return strcpy(buf, "?");
+    for(len=0; p[len] && p[len] != '\n' && len < 20; len++) buf[len] = p[len];
+    buf[len] = NULLCHAR;
+    return buf;
+}
 
-    for(i=0; i<nPlayers; i++) score[i] = games[i] = 0;
+static char *
+Duration (int sec, char *buf)
+{
+    if(sec >= 3600) sprintf(buf, "%d:%02d:%02d", sec/3600, sec/60%60, sec%60);
+    else sprintf(buf, "%d:%02d", sec/60, sec%60);
+    return buf;
+}
 
-    while(result = appData.results[nr]) {
-	color = Pairing(nr, nPlayers, &w, &b, &dummy);
-	if(!(color ^ matchGame & 1)) { dummy = w; w = b; b = dummy; }
-	wScore = bScore = 0;
-	switch(result) {
-	  case '+': wScore = 2; break;
-	  case '-': bScore = 2; break;
-	  case '=': wScore = bScore = 1; break;
-	  case ' ':
-	  case '*': return strdup("busy"); // tourney not finished
-	}
-	score[w] += wScore;
-	score[b] += bScore;
-	games[w]++;
-	games[b]++;
-	nr++;
-    }
-    if(appData.tourneyType > 0) nPlayers = appData.tourneyType; // in gauntlet, list only gauntlet engine(s)
-    for(w=0; w<nPlayers; w++) {
-	bScore = -1;
-	for(i=0; i<nPlayers; i++) if(score[i] > bScore) bScore = score[i], b = i;
-	ranking[w] = b; points[w] = bScore; score[b] = -2;
-    }
-    p = malloc(nPlayers*34+1);
-    for(w=0; w<nPlayers && w<display; w++)
-	sprintf(p+34*w, "%2d. %5.1f/%-3d %-19.19s\n", w+1, points[w]/2., games[ranking[w]], names[ranking[w]]);
-    free(names[0]);
+char *
+TourneyDashboard ()
+{   // [HGM] dashboard: progress of the current tourney, what every worker slot is doing, and the cross-table
+    StateHeader h;
+    int i, n, c, w, b, len, done = 0, playing = 0, busy = 0, avg = 0, slots = 0;
+    double eta = 0;
+    time_t now = time(NULL);
+    char *p, *q, *table, name1[24], name2[24], buf1[16], buf2[16];
+
+    if(!appData.tourneyFile[0] || !appData.participants) return strdup(_("No tourney in progress"));
+    if(LockTourneyState(&h)) {
+	StateHeader live = h; // header is written back on unlock, so weed out dead slots in a copy
+	slots = MAX_WORKERS;
+	for(i=0; i<slots; i++) // same test as ReserveGame: the slot of an instance that died holds no game in play
+	    if(live.slotGame[i] && GameSlot(live.slotGame[i] - 1, -1) != '*') live.slotGame[i] = 0;
+	UnlockTourneyState(&h);
+	h = live;
+    } else memset(&h, 0, sizeof(h));
+    n = CountPlayers(appData.participants);
+    len = strlen(appData.results);
+    for(i=0; i<len && i<appData.matchGames; i++) {
+	c = appData.results[i];
+	if(c == '*') playing++; else if(c != ' ') done++;
+    }
+    for(i=0; i<slots; i++) if(h.slotGame[i]) busy++;
+    if(h.timedGames) avg = h.busyTime / h.timedGames;
+
+    table = StandingsText(1000000, TRUE);
+    p = q = malloc(strlen(table) + (busy + 10) * MSG_SIZ);
+    q += sprintf(q, "%s\n", appData.tourneyFile);
+    q += sprintf(q, _("Games: %d of %d done, %d playing, %d to go\n"), done, appData.matchGames, playing,
+		 appData.matchGames - done - playing);
+    if(avg > 0) {
+	for(i=0; i<slots; i++) if(h.slotGame[i] && now - h.slotStart[i] < avg) eta += avg - (now - h.slotStart[i]);
+	eta = (eta + (double) avg * (appData.matchGames - done - playing)) / (busy ? busy : 1);
+	q += sprintf(q, _("Average game: %s   Throughput: %.1f games/hour   Finished in: %s\n"),
+		     Duration(avg, buf1), 3600. * (busy ? busy : 1) / avg, Duration((int) eta, buf2));
+    }
+    if(busy) q += sprintf(q, _("\nSlot  Game  Running  White - Black\n"));
+    for(i=0; i<slots; i++) if(h.slotGame[i]) {
+	int nr = h.slotGame[i] - 1;
+	if(!GamePlayers(nr, n, &w, &b)) w = b = -1;
+	q += sprintf(q, "%4d %5d %8s  %s - %s\n", i, nr + 1, Duration(now - h.slotStart[i], buf1),
+		     PlayerName(w, name1), PlayerName(b, name2));
+    }
+    sprintf(q, "\n%s", table);
+    free(table);
     return p;
 }
 
@@ -7593,6 +8295,144 @@ Count (Board board, int pCnt[], int *nW, int *nB, int *wStale, int *bStale, int
 	}
 }
 
+/* [HGM] repetition: every position of the game gets a hash key, and is linked to the previous occurrence of the
+ * same position (with the same side to move), found through a small hash table of the positions since the last
+ * irreversible move. Repetition tests then only have to visit actual repetitions, rather than comparing the current
+ * board with all earlier ones. The last irreversible ply is recorded for every position as well, for the 50-move rule.
+ */
+
+#define REP_TABLE 256
+
+static u64 posHash[MAX_MOVES];
+static short samePos[MAX_MOVES], lastIrreversible[MAX_MOVES], repTable[REP_TABLE];
+static int repEntries, hashedUpTo = -1;
+
+static u64
+BoardHash (Board board, int ply)
+{   // FNV-1a over the board (including holdings), and side to move
+    u64 h = u64Const(0xcbf29ce484222325);
+    int i, j;
+    for(i=0; i<BOARD_HEIGHT; i++) for(j=0; j<BOARD_WIDTH; j++) h = (h ^ (board[i][j] + 1)) * u64Const(0x100000001b3);
+    return h ^ (ply & 1);
+}
+
+static void
+RepInsert (int ply)
+{   // enter position in table, replacing its previous occurrence
+    int slot = posHash[ply] & (REP_TABLE-1);
+    while(repTable[slot] >= 0 && posHash[repTable[slot]] != posHash[ply]) slot = (slot + 1) & (REP_TABLE-1);
+    if(repTable[slot] < 0) repEntries++;
+    repTable[slot] = ply;
+}
+
+static void
+RepClear (int ply, int drop)
+{   // restart table with the positions before ply that can still be repeated
+    int p = (drop ? backwardMostMove : lastIrreversible[ply]);
+    if(p < ply - 100) p = ply - 100;
+    for(repEntries=0; repEntries<REP_TABLE; repEntries++) repTable[repEntries] = -1;
+    for(repEntries=0; p<ply; p++) RepInsert(p);
+}
+
+static void
+HashPosition (int ply, int prevIrreversible, int drop)
+{
+    int slot;
+    posHash[ply] = BoardHash(boards[ply], ply);
+    lastIrreversible[ply] = (ply == backwardMostMove || (signed char)boards[ply][EP_STATUS] > EP_NONE ? ply : prevIrreversible);
+    if((!drop && lastIrreversible[ply] == ply) || repEntries >= REP_TABLE/2) RepClear(ply, drop);
+    slot = posHash[ply] & (REP_TABLE-1);
+    while(repTable[slot] >= 0 && posHash[repTable[slot]] != posHash[ply]) slot = (slot + 1) & (REP_TABLE-1);
+    samePos[ply] = repTable[slot]; // previous occurrence, or -1
+    RepInsert(ply);
+}
+
+static void
+UpdatePositionHashes (int drop)
+{   // bring hashes up to date for forwardMostMove; normally only that position is new
+    int p, start, first;
+    if(forwardMostMove == hashedUpTo + 1 && forwardMostMove > backwardMostMove &&
+       posHash[hashedUpTo] == BoardHash(boards[hashedUpTo], hashedUpTo)) { // (not a new game that happens to fit)
+	HashPosition(forwardMostMove, lastIrreversible[forwardMostMove-1], drop);
+    } else { // game was reset, loaded or taken back: redo all positions that matter
+	for(p = forwardMostMove; p > backwardMostMove && (signed char)boards[p][EP_STATUS] <= EP_NONE; p--);
+	start = (p < forwardMostMove - 100 ? forwardMostMove - 100 : p);
+	if(drop && start > forwardMostMove - 100) start = forwardMostMove - 100;
+	if(start < backwardMostMove) start = backwardMostMove;
+	for(repEntries=0; repEntries<REP_TABLE; repEntries++) repTable[repEntries] = -1;
+	for(repEntries=0, first=start; start <= forwardMostMove; start++)
+	    HashPosition(start, start > first ? lastIrreversible[start-1] : p, drop);
+    }
+    hashedUpTo = forwardMostMove;
+}
+
+char *
+EgtPath (char *format)
+{   // [HGM] EGT: path the user gave for the given tablebase format in -egtFormats, or NULL
+    static char buf[MSG_SIZ];
+    char *p = appData.egtFormats;
+    int len = strlen(format);
+    while(p && *p) {
+	if(!strncmp(p, format, len) && p[len] == ':') {
+	    safeStrCpy(buf, p + len + 1, MSG_SIZ);
+	    if((p = strchr(buf, ',')) != NULL) *p = NULLCHAR;
+	    return buf;
+	}
+	if((p = strchr(p, ',')) != NULL) p++;
+    }
+    return NULL;
+}
+
+int
+ProbeSyzygy (Board board, int whiteToMove, int nPieces, int rule50, ChessMove *result)
+{   // [HGM] syzygy: look up the position in the (memory-mapped) Syzygy tables; returns FALSE if not found
+    // WDL tables suffice when the 50-move counter was just reset; otherwise DTZ tells whether the win comes in time
+#if HAVE_FATHOM
+    static char *initPath;
+    uint64_t white = 0, black = 0, kings = 0, queens = 0, rooks = 0, bishops = 0, knights = 0, pawns = 0, bit;
+    unsigned int wdl, ep = 0;
+    char *path = EgtPath("syzygy");
+    int r, f;
+
+    if(path == NULL || gameInfo.variant != VariantNormal || BOARD_HEIGHT != 8 || BOARD_RGHT - BOARD_LEFT != 8) return FALSE;
+    if(!initPath || strcmp(initPath, path)) { // (re)load tables
+	tb_init(path);
+	ASSIGN(initPath, path);
+	if(appData.debugMode) fprintf(debugFP, "Syzygy tables in %s: up to %d men\n", path, TB_LARGEST);
+    }
+    if(nPieces > TB_LARGEST) return FALSE;
+    for(r=0; r<6; r++) if(board[CASTLING][r] != NoRights) return FALSE; // tables have no castling
+    for(r=0; r<8; r++) for(f=0; f<8; f++) {
+	ChessSquare p = board[r][f + BOARD_LEFT];
+	if(p == EmptySquare) continue;
+	bit = (uint64_t)1 << (8*r + f);
+	if(p < BlackPawn) white |= bit; else black |= bit, p -= BlackPawn;
+	switch(p) {
+	  case WhitePawn:   pawns   |= bit; break;
+	  case WhiteKnight: knights |= bit; break;
+	  case WhiteBishop: bishops |= bit; break;
+	  case WhiteRook:   rooks   |= bit; break;
+	  case WhiteQueen:  queens  |= bit; break;
+	  case WhiteKing:   kings   |= bit; break;
+	  default: return FALSE; // fairy piece
+	}
+    }
+    if((signed char)board[EP_STATUS] >= 0) ep = 8*(whiteToMove ? 5 : 2) + board[EP_STATUS] - BOARD_LEFT;
+    if(rule50 == 0) wdl = tb_probe_wdl(white, black, kings, queens, rooks, bishops, knights, pawns, 0, 0, ep, whiteToMove);
+    else {
+	wdl = tb_probe_root(white, black, kings, queens, rooks, bishops, knights, pawns, rule50, 0, ep, whiteToMove, NULL);
+	if(wdl == TB_RESULT_CHECKMATE || wdl == TB_RESULT_STALEMATE) return FALSE; // game already over (handled elsewhere)
+	if(wdl != TB_RESULT_FAILED) wdl = TB_GET_WDL(wdl); // cursed / blessed when the counter leaves too few moves
+    }
+    if(wdl == TB_RESULT_FAILED) return FALSE;
+    if(appData.ruleMoves > 0 && (wdl == TB_CURSED_WIN || wdl == TB_BLESSED_LOSS)) wdl = TB_DRAW; // 50-move rule saves it
+    *result = wdl == TB_DRAW ? GameIsDrawn : (wdl == TB_WIN || wdl == TB_CURSED_WIN) == whiteToMove ? WhiteWins : BlackWins;
+    return TRUE;
+#else
+    return FALSE;
+#endif
+}
+
 int
 SufficientDefence (int pCnt[], int side, int nMine, int nHis)
 {
@@ -7823,6 +8663,21 @@ Adjudicate (ChessProgramState *cps)
 		    return 1;
 		}
 
+		/* [HGM] syzygy: with few enough pieces left, tablebases know the outcome */
+		if(canAdjudicate && appData.tablebaseAdjudication && nrW + nrB <= 7) {
+		  for(k = forwardMostMove; k > backwardMostMove && (signed char)boards[k][EP_STATUS] <= EP_NONE; k--);
+		  k = forwardMostMove - k + (k == backwardMostMove ? initialRulePlies : 0); // 50-move counter
+		  if(ProbeSyzygy(boards[forwardMostMove], WhiteOnMove(forwardMostMove), nrW + nrB, k, &result)) {
+		    if(engineOpponent) {
+		      SendToProgram("force\n", engineOpponent); // suppress reply
+		      SendMoveToProgram(forwardMostMove-1, engineOpponent); /* make sure opponent gets to see last move */
+		    }
+		    GameEnds( result, result == GameIsDrawn ? "Xboard adjudication: tablebase draw" :
+					  "Xboard adjudication: tablebase win", GE_XBOARD );
+		    return 1;
+		  }
+		}
+
                 /* Next absolutely insufficient mating material. */
                 if(!MatingPotential(nr, WhitePawn, nrW, nrB, staleW, bishopColor) &&
                    !MatingPotential(nr, BlackPawn, nrB, nrW, staleB, bishopColor))
@@ -7869,11 +8724,11 @@ Adjudicate (ChessProgramState *cps)
                 count = 0;
                 drop = gameInfo.holdingsSize && (gameInfo.variant != VariantSuper && gameInfo.variant != VariantSChess
                                               && gameInfo.variant != VariantGreat && gameInfo.variant != VariantGrand);
-                for(k = forwardMostMove-2;
+                UpdatePositionHashes(drop); // [HGM] repetition: only visit earlier occurrences of the current position
+                for(k = samePos[forwardMostMove];
                     k>=backwardMostMove && k>=forwardMostMove-100 && (drop ||
-                        (signed char)boards[k][EP_STATUS] < EP_UNKNOWN &&
-                        (signed char)boards[k+2][EP_STATUS] <= EP_NONE && (signed char)boards[k+1][EP_STATUS] <= EP_NONE);
-                    k-=2)
+                        ((signed char)boards[k][EP_STATUS] < EP_UNKNOWN && k >= lastIrreversible[forwardMostMove]));
+                    k = samePos[k])
                 {   int rights=0;
                     if(CompareBoards(boards[k], boards[forwardMostMove])) {
                         /* compare castling rights */
@@ -7950,10 +8805,7 @@ Adjudicate (ChessProgramState *cps)
                 }
 
                 /* Now we test for 50-move draws. Determine ply count */
-                count = forwardMostMove;
-                /* look for last irreversble move */
-                while( (signed char)boards[count][EP_STATUS] <= EP_NONE && count > backwardMostMove )
-                    count--;
+                count = lastIrreversible[forwardMostMove]; // [HGM] repetition: was kept with the hashes
                 /* if we hit starting position, add initial plies */
                 if( count == backwardMostMove )
                     count -= initialRulePlies;
@@ -8069,7 +8921,7 @@ LoadError (char *errmess, ChessProgramState *cps)
 {   // unloads engine and switches back to -ncp mode if it was first
     if(cps->initDone) return FALSE;
     cps->isr = NULL; // this should suppress further error popups from breaking pipes
-    DestroyChildProcess(cps->pr, 9 ); // just to be sure
+    if(cps->pr != NoProc) DestroyChildProcess(cps->pr, 9 ); // just to be sure
     cps->pr = NoProc;
     if(cps == &first) {
 	appData.noChessProgram = TRUE;
@@ -8098,11 +8950,48 @@ static int savedWhitePlayer, savedBlackPlayer, pairingReceived;
 static ChessProgramState *stalledEngine;
 static char stashedInputMove[MSG_SIZ];
 
+// [HGM] dispatch: engine commands that are recognized by their first word (always followed by arguments).
+// Messages that are recognized by a prefix or substring (results, errors, 'warning', the old ICS commands)
+// do not have a first word to look up, and are still tested one by one after these.
+typedef enum { EC_NONE = -1, EC_FEATURE, EC_SETUP, EC_SETBOARD, EC_TELLUSER, EC_TELLUSERERROR, EC_TELLOPPONENT,
+	       EC_TELLOTHERS, EC_TELLALL, EC_TELLICS, EC_TELLICSNOALIAS, EC_ASKUSER, EC_PONG, EC_HINT } EngineCommand;
+
+static char *engineCommands[] = { // in order of EngineCommand
+    "feature", "setup", "setboard", "telluser", "tellusererror", "tellopponent",
+    "tellothers", "tellall", "tellics", "tellicsnoalias", "askuser", "pong", "Hint:", NULL
+};
+
+static int
+Tokens (char *message, char **tok, int *len, int n)
+{   // find the first n white-space delimited words of message (as "%s" would), without copying them
+    int i;
+    for(i=0; i<n; i++) {
+	while(isspace(*message)) message++;
+	if(!*message) break;
+	tok[i] = message;
+	while(*message && !isspace(*message)) message++;
+	len[i] = message - tok[i];
+    }
+    return i;
+}
+
+static EngineCommand
+CommandType (char *message, char *tok, int len)
+{   // table look-up of a first word that starts the line and is followed by more
+    int i;
+    if(tok != message || !message[len]) return EC_NONE;
+    for(i=0; engineCommands[i]; i++)
+	if(!strncmp(engineCommands[i], tok, len) && engineCommands[i][len] == NULLCHAR) return i;
+    return EC_NONE;
+}
+
 void
 HandleMachineMove (char *message, ChessProgramState *cps)
 {
     char machineMove[MSG_SIZ], buf1[MSG_SIZ*10], buf2[MSG_SIZ];
-    char realname[MSG_SIZ];
+    char realname[MSG_SIZ], *tok[3];
+    int len[3], nTok;
+    EngineCommand command;
     int fromX, fromY, toX, toY;
     ChessMove moveType;
     char promoChar;
@@ -8156,12 +9045,21 @@ FakeBookMove: // [HGM] book: we jump here to simulate machine moves after book h
 	}
     }
 
+    /*
+     * [HGM] dispatch: split off the first words once, and classify the line by them
+     */
+    nTok = Tokens(message, tok, len, 3);
+    command = nTok ? CommandType(message, tok[0], len[0]) : EC_NONE;
+
     /*
      * Look for machine move.
      */
-    if ((sscanf(message, "%s %s %s", buf1, buf2, machineMove) == 3 && strcmp(buf2, "...") == 0) ||
-	(sscanf(message, "%s %s", buf1, machineMove) == 2 && strcmp(buf1, "move") == 0))
+    if ((nTok == 3 && len[1] == 3 && !strncmp(tok[1], "...", 3) && (p = tok[2])) ||
+	(nTok >= 2 && len[0] == 4 && !strncmp(tok[0], "move", 4) && (p = tok[1])))
     {
+	safeStrCpy(machineMove, p, MSG_SIZ);
+	for(p=machineMove; *p && !isspace(*p); p++);
+	*p = NULLCHAR;
         if(pausing && !cps->pause) { // for pausing engine that does not support 'pause', we stash its move for processing when we resume.
 	    if(appData.debugMode) fprintf(debugFP, "pause %s engine after move\n", cps->which);
 	    safeStrCpy(stashedInputMove, message, MSG_SIZ);
@@ -8302,6 +9200,9 @@ FakeBookMove: // [HGM] book: we jump here to simulate machine moves after book h
         pvInfoList[ forwardMostMove ].score = programStats.score;
         pvInfoList[ forwardMostMove ].depth = programStats.depth;
         pvInfoList[ forwardMostMove ].time =  programStats.time; // [HGM] PGNtime: take time from engine stats
+        pvInfoList[ forwardMostMove ].usec = 0;
+        pvNodes[ forwardMostMove ] = programStats.nodes;
+        EndLatency(cps); // [HGM] latency: time since engine was set thinking
 
 	MakeMove(fromX, fromY, toX, toY, promoChar);/*updates forwardMostMove*/
 
@@ -8334,6 +9235,27 @@ FakeBookMove: // [HGM] book: we jump here to simulate machine moves after book h
             }
         }
 
+        /* [HGM] adjudicate: draw when both engines see a balanced position for a number of plies after the given move */
+        if( gameMode == TwoMachinesPlay && appData.adjudicateDrawThreshold > 0 && appData.adjudicateDrawPlies > 0
+            && forwardMostMove - appData.adjudicateDrawPlies >= 2*appData.adjudicateDrawStart // whole window after the start move
+            && forwardMostMove - backwardMostMove >= appData.adjudicateDrawPlies ) {
+            int count = 0;
+
+            while( count < appData.adjudicateDrawPlies ) { // book moves and engines that report no depth interrupt the window
+                ChessProgramStats_Move *info = &pvInfoList[ forwardMostMove - count - 1 ];
+                if( info->depth <= 0 || abs(info->score) > appData.adjudicateDrawThreshold ) break;
+                count++;
+            }
+
+            if( count >= appData.adjudicateDrawPlies ) {
+	        ShowMove(fromX, fromY, toX, toY); /*updates currentMove*/
+
+                GameEnds( GameIsDrawn, "Xboard adjudication: draw score", GE_XBOARD );
+
+                return;
+            }
+        }
+
 	if(Adjudicate(cps)) {
 	    ShowMove(fromX, fromY, toX, toY); /*updates currentMove*/
 	    return; // [HGM] adjudicate: for all automatic game ends
@@ -8390,6 +9312,7 @@ if(appData.debugMode) fprintf(debugFP, "nodes = %d, %lld\n", (int) programStats.
 		SendToProgram("go\n", cps->other);
 	    }
 	    cps->other->maybeThinking = TRUE;
+	    if(!bookHit) GetTimeMark(&cps->other->moveSent), cps->other->moveTimed = TRUE;
 	}
 
 	ShowMove(fromX, fromY, toX, toY); /*updates currentMove*/
@@ -8431,6 +9354,16 @@ if(appData.debugMode) fprintf(debugFP, "nodes = %d, %lld\n", (int) programStats.
 	return;
     }
 
+    /*
+     * [HGM] dispatch: lines starting with a number (but not a game result) are thinking output; this is by far
+     * the bulk of what engines send, so we do not waste time on probing them for any of the other commands.
+     */
+    if (isdigit(*message) && strncmp(message, "1-0", 3) && strncmp(message, "0-1", 3) && strncmp(message, "1/2", 3)) {
+	if (gameMode == BeginningOfGame || gameMode == EndOfGame ||
+	    gameMode == IcsIdle || cps->lastPing != cps->lastPong) return;
+	goto Thinking;
+    }
+
     /* Set special modes for chess engines.  Later something general
      *  could be added here; for now there is just one kludge feature,
      *  needed because Crafty 15.10 and earlier don't ignore SIGINT
@@ -8440,12 +9373,12 @@ if(appData.debugMode) fprintf(debugFP, "nodes = %d, %lld\n", (int) programStats.
 	cps->useSigint = FALSE;
 	cps->useSigterm = FALSE;
     }
-    if (strncmp(message, "feature ", 8) == 0) { // [HGM] moved forward to pre-empt non-compliant commands
+    if (command == EC_FEATURE) { // [HGM] moved forward to pre-empt non-compliant commands
       ParseFeatures(message+8, cps);
       return; // [HGM] This return was missing, causing option features to be recognized as non-compliant commands!
     }
 
-    if (!strncmp(message, "setup ", 6) && 
+    if (command == EC_SETUP && 
 	(!appData.testLegality || gameInfo.variant == VariantFairy || NonStandardBoardSize())
 					) { // [HGM] allow first engine to define opening position
       int dummy, s=6; char buf[MSG_SIZ];
@@ -8461,7 +9394,7 @@ if(appData.debugMode) fprintf(debugFP, "nodes = %d, %lld\n", (int) programStats.
     /* [HGM] Allow engine to set up a position. Don't ask me why one would
      * want this, I was asked to put it in, and obliged.
      */
-    if (!strncmp(message, "setboard ", 9)) {
+    if (command == EC_SETBOARD) {
         Board initial_position;
 
         GameEnds(GameUnfinished, "Engine aborts game", GE_XBOARD);
@@ -8483,14 +9416,14 @@ if(appData.debugMode) fprintf(debugFP, "nodes = %d, %lld\n", (int) programStats.
     /*
      * Look for communication commands
      */
-    if (!strncmp(message, "telluser ", 9)) {
+    if (command == EC_TELLUSER) {
 	if(message[9] == '\\' && message[10] == '\\')
 	    EscapeExpand(message+9, message+11); // [HGM] esc: allow escape sequences in popup box
 	PlayTellSound();
 	DisplayNote(message + 9);
 	return;
     }
-    if (!strncmp(message, "tellusererror ", 14)) {
+    if (command == EC_TELLUSERERROR) {
 	cps->userError = 1;
 	if(message[14] == '\\' && message[15] == '\\')
 	    EscapeExpand(message+14, message+16); // [HGM] esc: allow escape sequences in popup box
@@ -8498,7 +9431,7 @@ if(appData.debugMode) fprintf(debugFP, "nodes = %d, %lld\n", (int) programStats.
 	DisplayError(message + 14, 0);
 	return;
     }
-    if (!strncmp(message, "tellopponent ", 13)) {
+    if (command == EC_TELLOPPONENT) {
       if (appData.icsActive) {
 	if (loggedOn) {
 	  snprintf(buf1, sizeof(buf1), "%ssay %s\n", ics_prefix, message + 13);
@@ -8509,7 +9442,7 @@ if(appData.debugMode) fprintf(debugFP, "nodes = %d, %lld\n", (int) programStats.
       }
       return;
     }
-    if (!strncmp(message, "tellothers ", 11)) {
+    if (command == EC_TELLOTHERS) {
       if (appData.icsActive) {
 	if (loggedOn) {
 	  snprintf(buf1, sizeof(buf1), "%swhisper %s\n", ics_prefix, message + 11);
@@ -8518,7 +9451,7 @@ if(appData.debugMode) fprintf(debugFP, "nodes = %d, %lld\n", (int) programStats.
       } else if(appData.autoComment) AppendComment (forwardMostMove, message + 11, 1); // in local mode, add as move comment
       return;
     }
-    if (!strncmp(message, "tellall ", 8)) {
+    if (command == EC_TELLALL) {
       if (appData.icsActive) {
 	if (loggedOn) {
 	  snprintf(buf1, sizeof(buf1), "%skibitz %s\n", ics_prefix, message + 8);
@@ -8534,7 +9467,7 @@ if(appData.debugMode) fprintf(debugFP, "nodes = %d, %lld\n", (int) programStats.
 	DisplayError(message, 0);
 	return;
     }
-    if (sscanf(message, "askuser %s %[^\n]", buf1, buf2) == 2) {
+    if (command == EC_ASKUSER && sscanf(message, "askuser %s %[^\n]", buf1, buf2) == 2) {
         safeStrCpy(realname, cps->tidy, sizeof(realname)/sizeof(realname[0]));
 	strcat(realname, " query");
 	AskQuestion(realname, buf2, buf1, cps->pr);
@@ -8545,12 +9478,12 @@ if(appData.debugMode) fprintf(debugFP, "nodes = %d, %lld\n", (int) programStats.
      *  interfere with the login process.
      */
     if (loggedOn) {
-	if (!strncmp(message, "tellics ", 8)) {
+	if (command == EC_TELLICS) {
 	    SendToICS(message + 8);
 	    SendToICS("\n");
 	    return;
 	}
-	if (!strncmp(message, "tellicsnoalias ", 15)) {
+	if (command == EC_TELLICSNOALIAS) {
 	    SendToICS(ics_prefix);
 	    SendToICS(message + 15);
 	    SendToICS("\n");
@@ -8565,7 +9498,13 @@ if(appData.debugMode) fprintf(debugFP, "nodes = %d, %lld\n", (int) programStats.
 	    return;
 	}
     }
-    if (sscanf(message, "pong %d", &cps->lastPong) == 1) {
+    if (command == EC_PONG && sscanf(message, "pong %d", &cps->lastPong) == 1) {
+	if(cps->pingTimed && cps->lastPong == cps->lastPing) { // [HGM] latency: round trip through idle engine
+	    TimeMark now;
+	    GetTimeMark(&now);
+	    AddLatency(&cps->pingLatency, &now, &cps->pingSent);
+	    cps->pingTimed = FALSE;
+	}
 	return;
     }
     /*
@@ -8717,7 +9656,7 @@ if(appData.debugMode) fprintf(debugFP, "nodes = %d, %lld\n", (int) programStats.
     /*
      * Look for hint output
      */
-    if (sscanf(message, "Hint: %s", buf1) == 1) {
+    if (command == EC_HINT && sscanf(message, "Hint: %s", buf1) == 1) {
 	if (cps == &first && hintRequested) {
 	    hintRequested = FALSE;
 	    if (ParseOneMove(buf1, forwardMostMove, &moveType,
@@ -8917,8 +9856,9 @@ if(appData.debugMode) fprintf(debugFP, "nodes = %d, %lld\n", (int) programStats.
     /*
      * Look for thinking output
      */
+  Thinking:
     if ( appData.showThinking // [HGM] thinking: test all options that cause this output
-	  || !appData.hideThinkingFromHuman || appData.adjudicateLossThreshold != 0 || EngineOutputIsUp()
+	  || !appData.hideThinkingFromHuman || appData.adjudicateLossThreshold != 0 || appData.adjudicateDrawThreshold > 0 || EngineOutputIsUp()
 				) {
 	int plylev, mvleft, mvtot, curscore, time;
 	char mvname[MOVE_LEN];
@@ -9367,7 +10307,7 @@ ParseGameHistory (char *game)
 	strcat(moveList[boardIndex], "\n");
 	boardIndex++;
 	ApplyMove(fromX, fromY, toX, toY, promoChar, boards[boardIndex]);
-        switch (MateTest(boards[boardIndex], PosFlags(boardIndex)) ) {
+        switch (CheckMateTest(boards[boardIndex], PosFlags(boardIndex)) ) {
 	  case MT_NONE:
 	  case MT_STALEMATE:
 	  default:
@@ -9788,7 +10728,7 @@ MakeMove (int fromX, int fromY, int toX, int toY, int promoChar)
     }
     CoordsToComputerAlgebraic(fromY, fromX, toY, toX, promoChar,
 			      moveList[forwardMostMove - 1]);
-    switch (MateTest(boards[forwardMostMove], PosFlags(forwardMostMove)) ) {
+    switch (CheckMateTest(boards[forwardMostMove], PosFlags(forwardMostMove)) ) {
       case MT_NONE:
       case MT_STALEMATE:
       default:
@@ -9975,7 +10915,7 @@ InitChessProgram (ChessProgramState *cps, int setup)
     }
     if (appData.showThinking
 	// [HGM] thinking: four options require thinking output to be sent
-	|| !appData.hideThinkingFromHuman || appData.adjudicateLossThreshold != 0 || EngineOutputIsUp()
+	|| !appData.hideThinkingFromHuman || appData.adjudicateLossThreshold != 0 || appData.adjudicateDrawThreshold > 0 || EngineOutputIsUp()
 				) {
 	SendToProgram("post\n", cps);
     }
@@ -10023,6 +10963,163 @@ ResendOptions (ChessProgramState *cps)
   }
 }
 
+// [HGM] pool: spare engine processes, started in advance and already through the 'xboard' / 'protover' handshake,
+//              so that the next game with -xreuse does not have to wait for engine startup.
+#define MAX_SPARES 32
+
+typedef struct {
+    char *program, *dir, *affinity; // affinity it was started with ("" if none), as a spare on other CPUs will not do
+    ProcRef pr;
+    InputSourceRef isr;
+    char *lines; // everything the engine said so far, to be replayed when it is taken into service
+    int len, size;
+} SpareEngine;
+
+static SpareEngine *spares[MAX_SPARES];
+
+static char *
+EngineAffinity (ChessProgramState *cps)
+{   // [HGM] affinity: CPUs an engine should run on; explicitly given per engine, or a share of the cores of this game slot
+    static char buf[MSG_SIZ];
+    int n = NumberOfCPUs(), slots = (appData.concurrency > 1 ? appData.concurrency : 1), size, start;
+    if(cps == &pairing) return NULL;
+    if(cps->affinity && *cps->affinity) return cps->affinity;
+    if(!appData.autoAffinity || n <= 0) return NULL;
+    size = n / slots; if(size < 1) size = 1;
+    start = (appData.workerNr % slots) * size % n;
+    if(size > 1) { // the two engines of a game each get half
+	size /= 2;
+	if(cps == &second) start += size;
+    }
+    snprintf(buf, MSG_SIZ, "%d-%d", start, start + size - 1);
+    return buf;
+}
+
+static int nrOfSpares;
+
+static int
+SpareFits (SpareEngine *sp, ChessProgramState *cps)
+{   // [HGM] pool: spare runs the engine cps needs, on the CPUs it should run on
+    char *a = EngineAffinity(cps);
+    return !strcmp(sp->program, cps->program) && !strcmp(sp->dir, cps->dir) && !strcmp(sp->affinity, a ? a : "");
+}
+
+static void
+FreeSpare (SpareEngine *sp)
+{
+    free(sp->program); free(sp->dir); free(sp->affinity); free(sp->lines); free(sp);
+}
+
+static void
+DropSpare (int n, int kill)
+{   // remove spare from pool, killing the process if requested
+    SpareEngine *sp = spares[n];
+    int err;
+    if(sp->isr) RemoveInputSource(sp->isr);
+    if(kill) {
+	OutputToProcess(sp->pr, "quit\n", 5, &err);
+	DestroyChildProcess(sp->pr, 10);
+    }
+    FreeSpare(sp);
+    for(nrOfSpares--; n<nrOfSpares; n++) spares[n] = spares[n+1];
+}
+
+static void
+SpareOutput (InputSourceRef isr, VOIDSTAR closure, char *message, int count, int error)
+{   // buffer the handshake output of a spare engine
+    SpareEngine *sp = (SpareEngine *) closure;
+    int i;
+    for(i=0; i<nrOfSpares; i++) if(spares[i] == sp) break;
+    if(i >= nrOfSpares || sp->isr != isr) return;
+    if(count <= 0) { // spare died before it was needed
+	if(appData.debugMode) fprintf(debugFP, "spare engine %s exited\n", sp->program);
+	DropSpare(i, FALSE);
+	return;
+    }
+    if(sp->len + count >= sp->size) sp->lines = realloc(sp->lines, sp->size = 2*(sp->len + count) + MSG_SIZ);
+    memcpy(sp->lines + sp->len, message, count); sp->len += count;
+    sp->lines[sp->len] = NULLCHAR;
+}
+
+static int
+PlaysNextGame (ChessProgramState *cps)
+{   // [HGM] pool: whether the engine of cps plays in the next game (as far as can be predicted)
+    int w, b, sync = 0, saveGame = matchGame, saveRound = roundNr;
+    if(nextGame > appData.matchGames || abortMatch) return FALSE; // no next game
+    if(!appData.tourneyFile[0] || appData.tourneyType < 0) return TRUE; // match, or Swiss (pairing not known yet)
+    Pairing(nextGame, CountPlayers(appData.participants), &w, &b, &sync);
+    matchGame = saveGame; roundNr = saveRound; // undo side effects
+    return cps->playerNr == w || cps->playerNr == b;
+}
+
+static void
+DropIdleSpares ()
+{   // [HGM] pool: kill spares that cannot be used for the game about to start
+    int i;
+    for(i=nrOfSpares-1; i>=0; i--) if(!SpareFits(spares[i], &first) && !SpareFits(spares[i], &second)) DropSpare(i, TRUE);
+}
+
+void
+PrepareSpare (ChessProgramState *cps)
+{   // [HGM] pool: top up the number of waiting copies of the engine cps is running to appData.enginePool
+    SpareEngine *sp;
+    char buf[MSG_SIZ], *affinity;
+    int i, n = 0, err;
+
+    if(appData.enginePool <= 0 || !matchMode || cps->protocolVersion < 2 || strcmp(cps->host, "localhost") || cps->uci) return;
+    if(!PlaysNextGame(cps)) return;
+    for(i=0; i<nrOfSpares; i++) if(SpareFits(spares[i], cps)) n++;
+    while(n++ < appData.enginePool) {
+	if(nrOfSpares >= MAX_SPARES) DropSpare(0, TRUE); // make room by killing the oldest
+	sp = (SpareEngine *) calloc(1, sizeof(SpareEngine));
+	SetChildAffinity(affinity = EngineAffinity(cps));
+	sp->affinity = strdup(affinity ? affinity : "");
+	if(StartChildProcess(cps->program, cps->dir, &sp->pr)) { free(sp->affinity); free(sp); return; }
+	sp->program = strdup(cps->program); sp->dir = strdup(cps->dir);
+	spares[nrOfSpares++] = sp;
+	sp->isr = AddInputSource(sp->pr, TRUE, SpareOutput, (VOIDSTAR) sp);
+	snprintf(buf, MSG_SIZ, "xboard\nprotover %d\n", cps->protocolVersion);
+	OutputToProcess(sp->pr, buf, strlen(buf), &err);
+	if(appData.debugMode) fprintf(debugFP, "spare %d: %s", nrOfSpares, buf);
+    }
+}
+
+void
+KillSpares ()
+{
+    while(nrOfSpares) DropSpare(nrOfSpares-1, TRUE);
+}
+
+static int
+TakeSpare (ChessProgramState *cps)
+{   // put a spare engine in service for cps, and process what it already sent as if it just arrived
+    SpareEngine *sp;
+    char *p, *q, c;
+    int i;
+
+    for(i=0; i<nrOfSpares; i++) if(SpareFits(spares[i], cps)) break;
+    if(i >= nrOfSpares) return FALSE;
+    sp = spares[i];
+    for(nrOfSpares--; i<nrOfSpares; i++) spares[i] = spares[i+1]; // leave pool before replay can call KillSpares
+    RemoveInputSource(sp->isr); sp->isr = NULL;
+    cps->pr = sp->pr;
+    cps->isr = AddInputSource(cps->pr, TRUE, ReceiveFromProgram, cps);
+    if(appData.debugMode) fprintf(debugFP, "using spare engine for %s\n", cps->which);
+    if(!cps->reload) { // do not clear options when reloading because of -xreuse
+	cps->nrOptions = 0;
+	cps->comboCnt = 0;
+    }
+    for(p = sp->lines; p && *p && cps->isr; p = q) { // replay buffered lines (stop if processing them killed the engine)
+	if(!(q = strchr(p, '\n'))) q = p + strlen(p); else q++;
+	c = *q; *q = NULLCHAR;
+	ReceiveFromProgram(cps->isr, (VOIDSTAR) cps, p, q - p, 0);
+	*q = c;
+    }
+    if(cps->reload && cps->pr != NoProc) ResendOptions(cps);
+    FreeSpare(sp);
+    return TRUE;
+}
+
 void
 StartChessProgram (ChessProgramState *cps)
 {
@@ -10031,8 +11128,12 @@ StartChessProgram (ChessProgramState *cps)
 
     if (appData.noChessProgram) return;
     cps->initDone = FALSE;
+    UCIStart(cps); // [HGM] uci: decide whether we must translate to UCI ourselves
+
+    if (cps->protocolVersion > 1 && !strcmp(cps->host, "localhost") && !cps->uci && TakeSpare(cps)) return;
 
     if (strcmp(cps->host, "localhost") == 0) {
+	SetChildAffinity(EngineAffinity(cps));
 	err = StartChildProcess(cps->program, cps->dir, &cps->pr);
     } else if (*appData.remoteShell == NULLCHAR) {
 	err = OpenRcmd(cps->host, appData.remoteUser, cps->program, &cps->pr);
@@ -10047,16 +11148,11 @@ StartChessProgram (ChessProgramState *cps)
 	err = StartChildProcess(buf, "", &cps->pr);
     }
 
-    if (err != 0) {
-      snprintf(buf, MSG_SIZ, _("Startup failure on '%s'"), cps->program);
-	DisplayError(buf, err); // [HGM] bit of a rough kludge: ignore failure, (which XBoard would do anyway), and let I/O discover it
-	if(cps != &first) return;
-	appData.noChessProgram = TRUE;
-	ThawUI();
-	SetNCPMode();
-//	DisplayFatalError(buf, err, 1);
-//	cps->pr = NoProc;
-//	cps->isr = NULL;
+    if (err != 0) { // [HGM] spawn: exec failures are now reported here, rather than through the child's output
+	snprintf(buf, MSG_SIZ, _("Failed to start %s chess program %s on %s: %s\n"),
+		 _(cps->which), cps->program, cps->host, strerror(err));
+	cps->pr = NoProc;
+	if(appData.icsActive) DisplayFatalError(buf, 0, 1); else LoadError(buf, cps);
 	return;
     }
 
@@ -10198,25 +11294,33 @@ Substitute (char *participants, int expunge)
 	if(mnemonic[i]) { // The substitute is valid
 	    FILE *f;
 	    if(appData.tourneyFile[0] && (f = fopen(appData.tourneyFile, "r+")) ) {
+		StateHeader h;
+		int locked;
 		flock(fileno(f), LOCK_EX);
 		ParseArgsFromFile(f);
 		fseek(f, 0, SEEK_SET);
 		FREE(appData.participants); appData.participants = participants;
+		if((locked = LockTourneyState(&h))) LoadResults(); // [HGM] state: get current results
 		if(expunge) { // erase results of replaced engine
 		    int len = strlen(appData.results), w, b, dummy;
 		    for(i=0; i<len; i++) {
 			Pairing(i, nPlayers, &w, &b, &dummy);
 			if((w == changed || b == changed) && appData.results[i] == '*') {
 			    DisplayError(_("You cannot replace an engine while it is engaged!\nTerminate its game first."), 0);
+			    if(locked) UnlockTourneyState(&h);
 			    fclose(f);
 			    return;
 			}
 		    }
 		    for(i=0; i<len; i++) {
 			Pairing(i, nPlayers, &w, &b, &dummy);
-			if(w == changed || b == changed) appData.results[i] = ' '; // mark as not played
+			if(w == changed || b == changed) {
+			    appData.results[i] = ' '; // mark as not played
+			    if(locked && GameSlot(i, ' ') && i < h.next) h.next = i;
+			}
 		    }
 		}
+		if(locked) UnlockTourneyState(&h);
 		WriteTourneyFile(appData.results, f);
 		fclose(f); // release lock
 		return;
@@ -10254,6 +11358,7 @@ int
 CreateTourney (char *name)
 {
 	FILE *f;
+	char buf[MSG_SIZ];
 	if(matchMode && strcmp(name, appData.tourneyFile)) {
 	     ASSIGN(name, appData.tourneyFile); //do not allow change of tourneyfile while playing
 	}
@@ -10276,6 +11381,8 @@ CreateTourney (char *name)
 	    ASSIGN(appData.tourneyFile, name);
 	    if(appData.tourneyType < 0) appData.defaultMatchGames = 1; // Swiss forces games/pairing = 1
 	    if((f = WriteTourneyFile("", NULL)) == NULL) return 0;
+	    snprintf(buf, MSG_SIZ, "%s.state", name); unlink(buf); // [HGM] state: stale state of earlier tourney with same name
+	    snprintf(buf, MSG_SIZ, "%s.pairs", name); unlink(buf);
 	}
 	fclose(f);
 	appData.noChessProgram = FALSE;
@@ -10346,6 +11453,7 @@ SwapEngines (int n)
     SWAP(features, p)
     SWAP(fenOverride, p)
     SWAP(NPS, h)
+    SWAP(affinity, p)
     SWAP(accumulateTC, h)
     SWAP(host, p)
 }
@@ -10462,6 +11570,154 @@ Pairing (int nr, int nPlayers, int *whitePlayer, int *blackPlayer, int *syncInte
     return curRound & 1;
 }
 
+/* [HGM] swiss: built-in Swiss pairing, used when no external pairing engine is given. Score, colour history,
+ * byes and who met whom are accounted incrementally for every round that completed, (using the players stored
+ * for each game), and a round is then paired in the spirit of the Dutch system: top-down by score group, with the
+ * upper half of a group preferably meeting the lower half, downfloating players that cannot be paired in their
+ * own group, and backtracking when that leads nowhere. The constraints are relaxed step by step should that fail.
+ */
+
+typedef struct {
+    int score;       // half points, bye counting as a win
+    int colorDiff;   // nr of whites minus nr of blacks
+    int lastColors;  // colours of last two games, 2 bits each (1 = white, 2 = black), last game in low bits
+    int byes;
+} SwissPlayer;
+
+static struct {
+    int nPlayers, rounds;  // rounds accounted
+    char *accounted;       // results string of the accounted rounds
+    SwissPlayer *player;
+    char *met;             // nPlayers x nPlayers
+    int pairedRound, *board, *order, *partner, level, budget;
+} swiss;
+
+static void
+SwissAccount (int round, int gamesPerRound)
+{   // add the games of a completed round
+    int g, w, b, wScore, n = swiss.nPlayers, *seen = calloc(n, sizeof(int));
+    for(g = round*gamesPerRound; g < (round+1)*gamesPerRound; g++) {
+	if(!StoredPairing(g, &w, &b) || w >= n || b >= n) continue;
+	switch(appData.results[g]) {
+	  case '+': wScore = 2; break;
+	  case '-': wScore = 0; break;
+	  default:  wScore = 1; break;
+	}
+	swiss.player[w].score += wScore; swiss.player[b].score += 2 - wScore;
+	swiss.player[w].colorDiff++; swiss.player[b].colorDiff--;
+	swiss.player[w].lastColors = (swiss.player[w].lastColors << 2 | 1) & 15;
+	swiss.player[b].lastColors = (swiss.player[b].lastColors << 2 | 2) & 15;
+	swiss.met[w*n + b] = swiss.met[b*n + w] = 1;
+	seen[w] = seen[b] = 1;
+    }
+    if(n & 1) for(g=0; g<n; g++) if(!seen[g]) swiss.player[g].byes++, swiss.player[g].score += 2;
+    free(seen);
+}
+
+static int
+MustHave (int i)
+{   // colour player must get: 1 = white, 2 = black, 0 = free
+    SwissPlayer *p = swiss.player + i;
+    if(p->colorDiff <= -2 || p->lastColors == 10) return 1; // 10 = black, black
+    if(p->colorDiff >=  2 || p->lastColors == 5) return 2;  //  5 = white, white
+    return 0;
+}
+
+static int
+Compatible (int i, int j)
+{
+    if(swiss.level < 2 && swiss.met[i*swiss.nPlayers + j]) return FALSE; // no rematches
+    return swiss.level > 0 || !MustHave(i) || MustHave(i) != MustHave(j);
+}
+
+static int
+SwissPairFrom (int k, int n)
+{   // pair the players in order[k...n-1], who are not paired yet
+    int i, j, m, half, c, p, q, *cand, *swap;
+    while(k < n && swiss.partner[swiss.order[k]] >= 0) k++;
+    if(k >= n) return TRUE;
+    if(--swiss.budget < 0) return FALSE;
+    swap = malloc(n*sizeof(int));
+    p = swiss.order[k];
+    cand = malloc(n*sizeof(int));
+    for(m=0, i=k+1; i<n; i++) // rest of p's score group
+	if(swiss.partner[q = swiss.order[i]] < 0 && swiss.player[q].score == swiss.player[p].score) cand[m++] = q;
+    half = (m+1)/2; // p tops the group, and should meet the player half-way down it
+    for(c=0, j=(half ? half-1 : 0); j<m; j++) swap[c++] = cand[j]; // lower half first
+    for(j=half-2; j>=0; j--) swap[c++] = cand[j]; // then upper half, from the bottom
+    for(i=k+1; i<n; i++) // then float down
+	if(swiss.partner[q = swiss.order[i]] < 0 && swiss.player[q].score != swiss.player[p].score) swap[c++] = q;
+    free(cand); cand = swap;
+    for(i=0; i<c; i++) {
+	if(!Compatible(p, cand[i])) continue;
+	swiss.partner[p] = cand[i]; swiss.partner[cand[i]] = p;
+	if(SwissPairFrom(k+1, n)) { free(cand); return TRUE; }
+	swiss.partner[p] = swiss.partner[cand[i]] = -1;
+    }
+    free(cand);
+    return FALSE;
+}
+
+static int
+CompareSwiss (const void *a, const void *b)
+{
+    int i = *(int *)a, j = *(int *)b;
+    if(swiss.player[i].score != swiss.player[j].score) return swiss.player[j].score - swiss.player[i].score;
+    return i - j; // participant order is seeding order
+}
+
+static int
+WhiteOf (int i, int j, int round)
+{   // colour allocation: equalize colours, then alternate, then higher ranked gets the colour of the round
+    int a = swiss.player[i].colorDiff, b = swiss.player[j].colorDiff, la = swiss.player[i].lastColors & 3, lb = swiss.player[j].lastColors & 3;
+    if(MustHave(i) != MustHave(j)) return MustHave(i) == 1 || MustHave(j) == 2 ? i : j;
+    if(a != b) return a < b ? i : j;
+    if(la != lb) return la == 2 ? i : la == 1 ? j : lb == 1 ? i : j;
+    return round & 1 ? j : i; // i is higher ranked
+}
+
+static int
+SwissPairing (int nr, int nPlayers, int *whitePlayer, int *blackPlayer)
+{   // pairing for game nr of a Swiss tourney; returns FALSE if it cannot be paired
+    int i, j, n = nPlayers, gamesPerRound = nPlayers/2, round = nr/gamesPerRound, len = strlen(appData.results);
+
+    if(gamesPerRound == 0) return FALSE;
+    if(n != swiss.nPlayers || swiss.rounds > round ||
+       swiss.rounds*gamesPerRound > len || (swiss.rounds && strncmp(swiss.accounted, appData.results, swiss.rounds*gamesPerRound))) { // start over
+	FREE(swiss.player); FREE(swiss.met); FREE(swiss.board); FREE(swiss.order); FREE(swiss.partner);
+	swiss.player = calloc(n, sizeof(SwissPlayer)); swiss.met = calloc(n*n, 1);
+	swiss.board = calloc(n, sizeof(int)); swiss.order = calloc(n, sizeof(int)); swiss.partner = calloc(n, sizeof(int));
+	swiss.nPlayers = n; swiss.rounds = 0; swiss.pairedRound = -1;
+    }
+    while(swiss.rounds < round) SwissAccount(swiss.rounds++, gamesPerRound); // all earlier rounds are finished
+    ASSIGN(swiss.accounted, appData.results);
+
+    if(swiss.pairedRound != round) { // pair the round
+	for(i=0; i<n; i++) swiss.order[i] = i, swiss.partner[i] = -1;
+	qsort(swiss.order, n, sizeof(int), CompareSwiss);
+	if(n & 1) { // bye for the lowest ranked player with fewest byes
+	    for(j=n-1, i=n-2; i>=0; i--) if(swiss.player[swiss.order[i]].byes < swiss.player[swiss.order[j]].byes) j = i;
+	    swiss.partner[swiss.order[j]] = swiss.order[j];
+	}
+	for(swiss.level=0; swiss.level<3; swiss.level++) {
+	    swiss.budget = 20*n;
+	    if(SwissPairFrom(0, n)) break;
+	    for(i=0; i<n; i++) if(swiss.partner[i] != i) swiss.partner[i] = -1;
+	}
+	if(swiss.level == 3) return FALSE;
+	for(i=j=0; i<n; i++) { // boards in order of ranking of the higher player
+	    int p = swiss.order[i], q = swiss.partner[p];
+	    if(q == p || CompareSwiss(&q, &p) < 0) continue; // bye, or already on board
+	    swiss.board[2*j] = WhiteOf(p, q, round); swiss.board[2*j+1] = swiss.board[2*j] == p ? q : p; j++;
+	}
+	swiss.pairedRound = round;
+	if(appData.debugMode) fprintf(debugFP, "Swiss round %d paired at level %d\n", round+1, swiss.level);
+    }
+    i = nr % gamesPerRound;
+    *whitePlayer = swiss.board[2*i]; *blackPlayer = swiss.board[2*i+1];
+    return TRUE;
+}
+
 int
 NextTourneyGame (int nr, int *swapColors)
 {   // !!!major kludge!!! fiddle appData settings to get everything in order for next tourney game
@@ -10472,6 +11728,7 @@ NextTourneyGame (int nr, int *swapColors)
     tf = fopen(appData.tourneyFile, "r");
     if(tf == NULL) { DisplayFatalError(_("Bad tournament file"), 0, 1); return 0; }
     ParseArgsFromFile(tf); fclose(tf);
+    ReadTourneyState(); // [HGM] state: results string in file might be stale
     InitTimeControls(); // TC might be altered from tourney file
 
     nPlayers = CountPlayers(appData.participants); // count participants
@@ -10491,13 +11748,16 @@ NextTourneyGame (int nr, int *swapColors)
     }
 
     if(appData.tourneyType < 0) {
+	if(nr>=0 && !appData.pairingEngine[0]) { // [HGM] swiss: no pairing engine, so pair ourselves
+	    if(!SwissPairing(nr, nPlayers, &savedWhitePlayer, &savedBlackPlayer)) {
+		DisplayFatalError(_("Cannot pair this Swiss round"), 0, 1);
+		return 0;
+	    }
+	    savedWhitePlayer++; savedBlackPlayer++; pairingReceived = 1; // as if pairing engine answered
+	}
 	if(nr>=0 && !pairingReceived) {
 	    char buf[1<<16];
 	    if(pairing.pr == NoProc) {
-		if(!appData.pairingEngine[0]) {
-		    DisplayFatalError(_("No pairing engine specified"), 0, 1);
-		    return 0;
-		}
 		StartChessProgram(&pairing); // starts the pairing engine
 	    }
 	    snprintf(buf, 1<<16, "results %d %s\n", nPlayers, appData.results);
@@ -10510,6 +11770,7 @@ NextTourneyGame (int nr, int *swapColors)
 	*swapColors = 0;
 	appData.matchGames = appData.tourneyCycles * syncInterval - 1;
 	whitePlayer = savedWhitePlayer-1; blackPlayer = savedBlackPlayer-1;
+	if(nr >= 0) StorePairing(nr, whitePlayer, blackPlayer); // [HGM] standings: needed to attribute the result
 	matchGame = 1; roundNr = nr / syncInterval + 1;
     }
 
@@ -10517,18 +11778,23 @@ NextTourneyGame (int nr, int *swapColors)
 
     // redefine engines, engine dir, etc.
     NamesToList(firstChessProgramNames, command, mnemonic, "all"); // get mnemonics of installed engines
+    if(first.playerNr != whitePlayer) ReportLatency(&first); // [HGM] latency: participant changes
+    if(second.playerNr != blackPlayer) ReportLatency(&second);
     if(first.pr == NoProc) {
       if(!SetPlayer(whitePlayer, appData.participants)) OK = 0; // find white player amongst it, and parse its engine line
       InitEngine(&first, 0);  // initialize ChessProgramStates based on new settings.
+      first.playerNr = whitePlayer;
     }
     if(second.pr == NoProc) {
       SwapEngines(1);
       if(!SetPlayer(blackPlayer, appData.participants)) OK = 0; // find black player amongst it, and parse its engine line
       SwapEngines(1);         // and make that valid for second engine by swapping
       InitEngine(&second, 1);
+      second.playerNr = blackPlayer;
     }
     CommonEngineInit();     // after this TwoMachinesEvent will create correct engine processes
     UpdateLogos(FALSE);     // leave display to ModeHiglight()
+    DropIdleSpares();       // [HGM] pool: replacements for engines that do not play now are useless
     return OK;
 }
 
@@ -10610,11 +11876,55 @@ GameCheckSum ()
 	return sum + StringCheckSum(commentList[i]);
 } // end of save patch
 
+static void
+StartUsage (ChessProgramState *cps)
+{   // [HGM] cpu: snapshot of what the engine used before this game
+    cps->usageValid = cps->pr != NoProc && !GetProcessUsage(cps->pr, &cps->usageStart);
+}
+
+static void
+GameUsage (ChessProgramState *cps)
+{   // [HGM] cpu: what the engine used during this game, also accumulated per tourney participant
+    ProcUsage now, *u = &cps->gameUsage;
+    if(cps->usageValid != 1 || cps->pr == NoProc || GetProcessUsage(cps->pr, &now)) { cps->usageValid = 0; return; }
+    u->userTime = now.userTime - cps->usageStart.userTime;
+    u->sysTime  = now.sysTime  - cps->usageStart.sysTime;
+    u->volSwitches   = now.volSwitches   - cps->usageStart.volSwitches;
+    u->involSwitches = now.involSwitches - cps->usageStart.involSwitches;
+    u->maxRSS = now.maxRSS; // peak is not per game
+    cps->usageValid = 2;
+    if(appData.debugMode)
+	fprintf(debugFP, "%s used %ld+%ld msec CPU, %ld kB, %ld+%ld context switches\n", cps->tidy,
+		u->userTime, u->sysTime, u->maxRSS, u->volSwitches, u->involSwitches);
+    if(matchMode && *appData.tourneyFile && cps->playerNr >= 0 && (UpdateStandings(), cps->playerNr < standings.nPlayers)) {
+	ProcUsage *t = standings.usage + cps->playerNr;
+	t->userTime += u->userTime; t->sysTime += u->sysTime;
+	t->volSwitches += u->volSwitches; t->involSwitches += u->involSwitches;
+	if(u->maxRSS > t->maxRSS) t->maxRSS = u->maxRSS;
+	standings.timed[cps->playerNr]++;
+    }
+}
+
+static void
+PrintUsageTags (FILE *f)
+{   // [HGM] cpu: per-engine resource tags, for engine-engine games
+    int i;
+    for(i=0; i<2; i++) {
+	ChessProgramState *cps = (i ? &second : &first);
+	char *color = (cps->twoMachinesColor[0] == 'w' ? "White" : "Black");
+	ProcUsage *u = &cps->gameUsage;
+	if(cps->usageValid != 2) continue;
+	fprintf(f, "[%sCPU \"%.2fs+%.2fs\"]\n", color, u->userTime/1000., u->sysTime/1000.);
+	if(u->maxRSS) fprintf(f, "[%sMaxRSS \"%ldk\"]\n", color, u->maxRSS);
+	if(u->volSwitches + u->involSwitches) fprintf(f, "[%sCtxSwitches \"%ld+%ld\"]\n", color, u->volSwitches, u->involSwitches);
+    }
+}
+
 void
 GameEnds (ChessMove result, char *resultDetails, int whosays)
 {
     GameMode nextGameMode;
-    int isIcsGame;
+    int isIcsGame, newSpares = 0;
     char buf[MSG_SIZ], popupRequested = 0, *ranking = NULL;
 
     if(endingGame) return; /* [HGM] crash: forbid recursion */
@@ -10674,6 +11984,7 @@ GameEnds (ChessMove result, char *resultDetails, int whosays)
 	StopClocks();
 	if (!isIcsGame && !appData.noChessProgram)
 	  SetUserThinkingEnables();
+	if (gameMode == TwoMachinesPlay) GameUsage(&first), GameUsage(&second); // [HGM] cpu: before the engines can be killed
 
         /* [HGM] if a machine claims the game end we verify this claim */
         if(gameMode == TwoMachinesPlay && appData.testClaims) {
@@ -10900,6 +12211,7 @@ GameEnds (ChessMove result, char *resultDetails, int whosays)
             DoSleep( appData.delayAfterQuit );
 	    DestroyChildProcess(first.pr, first.useSigterm);
 	    first.reload = TRUE;
+	    newSpares |= 1; // [HGM] pool: replace it once we know whether it plays the next game
 	}
 	first.pr = NoProc;
     }
@@ -10926,6 +12238,7 @@ GameEnds (ChessMove result, char *resultDetails, int whosays)
             DoSleep( appData.delayAfterQuit );
 	    DestroyChildProcess(second.pr, second.useSigterm);
 	    second.reload = TRUE;
+	    newSpares |= 2;
 	}
 	second.pr = NoProc;
     }
@@ -10956,12 +12269,19 @@ GameEnds (ChessMove result, char *resultDetails, int whosays)
 	}
 
 	if(exiting) resChar = ' '; // quit while waiting for round sync: unreserve already reserved game
+	if(resChar != ' ') LogMatchGame(appData.tourneyFile[0] ? nextGame + 1 : matchGame, result); // number from 1
 	if(appData.tourneyFile[0]){ // [HGM] we are in a tourney; update tourney file with game result
 	    if(appData.afterGame && appData.afterGame[0]) RunCommand(appData.afterGame);
 	    ReserveGame(nextGame, resChar); // sets nextGame
+	    WriteStandings();
 	    if(nextGame > appData.matchGames) appData.tourneyFile[0] = 0, ranking = TourneyStandings(3); // tourney is done
 	    else ranking = strdup("busy"); //suppress popup when aborted but not finished
-	} else roundNr = nextGame = matchGame + 1; // normal match, just increment; round equals matchGame
+	} else { // normal match, just increment; round equals matchGame
+	    roundNr = nextGame = matchGame + 1;
+	    if(SPRT(result)) appData.matchGames = matchGame; // [HGM] sprt: test is conclusive, so this was the last game
+	}
+	if(newSpares & 1) PrepareSpare(&first); // [HGM] pool: start the replacements while we are busy ending the game
+	if(newSpares & 2) PrepareSpare(&second);
 
 	if (nextGame <= appData.matchGames && !abortMatch) {
 	    gameMode = nextGameMode;
@@ -10976,7 +12296,9 @@ GameEnds (ChessMove result, char *resultDetails, int whosays)
 		     first.tidy, second.tidy,
 		     first.matchWins, second.matchWins,
 		     appData.matchGames - (first.matchWins + second.matchWins));
+	    strncat(buf, sprtVerdict, MSG_SIZ - strlen(buf) - 1);
 	    if(!appData.tourneyFile[0]) matchGame++, DisplayTwoMachinesTitle(); // [HGM] update result in window title
+	    ReportLatency(&first); ReportLatency(&second);
 	    if(ranking && strcmp(ranking, "busy") && appData.afterTourney && appData.afterTourney[0]) RunCommand(appData.afterTourney);
 	    popupRequested++; // [HGM] crash: postpone to after resetting endingGame
 	    if (appData.firstPlaysBlack) { // [HGM] match: back to original for next match
@@ -11204,6 +12526,7 @@ AutoPlayOneMove ()
       pvInfoList[currentMove].depth = programStats.depth;
       pvInfoList[currentMove].score = programStats.score;
       pvInfoList[currentMove].time  = 0;
+      pvInfoList[currentMove].usec  = 0;
       if(currentMove < forwardMostMove) AppendComment(currentMove+1, lastPV[0], 2);
       else { // append analysis of final position as comment
 	char buf[MSG_SIZ];
@@ -12074,6 +13397,13 @@ LoadGame (FILE *f, int gameNumber, char *title, int useList)
 	}
     } else {
 	GameListDestroy();
+	if (gameNumber < 0) { // [HGM] suite: negative game number means to seek to that byte offset, as in LoadPosition
+	    if (fseek(f, -gameNumber, 0) == -1) {
+		DisplayError(_("Can't seek on game file"), 0);
+		return FALSE;
+	    }
+	    gn = 1;
+	} else
 	if (fseek(f, 0, 0) == -1) {
 	    if (f == lastLoadGameFP ?
 	 	gameNumber == lastLoadGameNumber + 1 :
@@ -12616,6 +13946,14 @@ LoadPosition (FILE *f, int positionNumber, char *title)
 	      blackPlaysFirst = TRUE;
 	}
     }
+    return SetUpPosition(initial_position, positionNumber, title);
+}
+
+static int
+SetUpPosition (Board initial_position, int positionNumber, char *title)
+{   // [HGM] suite: second half of LoadPosition, which starts from the position it read
+    char line[MSG_SIZ];
+
     startedFromSetupPosition = TRUE;
 
     CopyBoard(boards[0], initial_position);
@@ -12657,6 +13995,42 @@ int i, j;
     return TRUE;
 }
 
+int
+LoadSuiteGame (int e, char *title)
+{   // [HGM] suite: load game e of the indexed suite, by seeking to it in the file the suite keeps open
+    int ok = LoadGame(suite.f, -suite.offset[e], title, FALSE);
+    lastLoadGameNumber = e + 1;
+    if(lastLoadGameFP == suite.f) lastLoadGameFP = NULL; // the next game will need it, so it should not be closed
+    return ok;
+}
+
+int
+LoadSuitePosition (int e, char *title)
+{   // [HGM] suite: set up FEN line e of the indexed suite, which is kept in memory, as LoadPosition does from a file
+    Board initial_position;
+
+    if (gameMode == Training )
+	SetTrainingModeOff();
+
+    if (gameMode != BeginningOfGame) {
+	Reset(FALSE, TRUE);
+    }
+    if (lastLoadPositionFP != NULL) {
+	fclose(lastLoadPositionFP); lastLoadPositionFP = NULL;
+    }
+    lastLoadPositionNumber = e + 1;
+    safeStrCpy(lastLoadPositionTitle, title, sizeof(lastLoadPositionTitle)/sizeof(lastLoadPositionTitle[0]));
+    if (first.pr == NoProc && !appData.noChessProgram) {
+      StartChessProgram(&first);
+      InitChessProgram(&first, FALSE);
+    }
+    if (!ParseFEN(initial_position, &blackPlaysFirst, suite.fen[e])) {
+	DisplayError(_("Bad FEN position in file"), 0);
+	return FALSE;
+    }
+    return SetUpPosition(initial_position, e + 1, title);
+}
+
 
 void
 CopyPlayerNameIntoFileName (char **dest, char *src)
@@ -12832,6 +14206,7 @@ SaveGamePGN (FILE *f)
     PrintPGNTags(f, &gameInfo);
 
     if(appData.numberTag && matchMode) fprintf(f, "[Number \"%d\"]\n", nextGame+1); // [HGM] number tag
+    if(appData.cpuTags && gameMode == TwoMachinesPlay) PrintUsageTags(f);
 
     if (backwardMostMove > 0 || startedFromSetupPosition) {
         char *fen = PositionToFEN(backwardMostMove, NULL, 1);
@@ -12920,6 +14295,9 @@ SaveGamePGN (FILE *f)
 
             seconds = (pvInfoList[i].time+5)/10; // deci-seconds, rounded to nearest
 
+            if( pvInfoList[i].usec > 0 && pvInfoList[i].usec < 1000000 ) // [HGM] usec: fast moves to the msec
+	      snprintf(buf, MSG_SIZ, " %5.3f%c", (pvInfoList[i].usec + 500)/1000 / 1000., 0);
+	    else
             if( seconds <= 0)
 	      buf[0] = 0;
 	    else
@@ -13445,6 +14823,12 @@ ResetGameEvent ()
 void
 ExitEvent (int status)
 {
+    if(!exiting && exitStatus < 0 && !abortMatch && nextGame > appData.matchGames && HelpersBusy()) {
+	// [HGM] concurrency: all games handed out; wait (in the event loop) for the helpers to finish theirs
+	exitStatus = status;
+	DisplayMessage("", _("Waiting for the helpers to finish their games; quit again to abort them"));
+	return;
+    }
     exiting++;
     if (exiting > 2) {
       /* Give up on clean exit */
@@ -13500,6 +14884,9 @@ ExitEvent (int status)
     if (pairing.pr != NoProc) SendToProgram("quit\n", &pairing);
     if (pairing.isr != NULL) RemoveInputSource(pairing.isr);
 
+    StopWorkers();
+    KillSpares();
+
     ShutDownFrontEnd();
     exit(status);
 }
@@ -13971,6 +15358,7 @@ WaitForEngine (ChessProgramState *cps, DelayedEventCallback retry)
     char buf[MSG_SIZ];
     if (cps->pr == NoProc) {
 	StartChessProgram(cps);
+	if (cps->pr == NoProc) return 1; // could not be started (and LoadError took care of that); do not retry
 	if (cps->protocolVersion == 1) {
 	  retry();
 	  ScheduleDelayedEvent(retry, 1); // Do this also through timeout to avoid recursive calling of 'retry'
@@ -13979,7 +15367,7 @@ WaitForEngine (ChessProgramState *cps, DelayedEventCallback retry)
 	  if(retry != TwoMachinesEventIfReady) FreezeUI();
 	  snprintf(buf, MSG_SIZ, _("Starting %s chess program"), _(cps->which));
 	  DisplayMessage("", buf);
-	  ScheduleDelayedEvent(retry, FEATURE_TIMEOUT);
+	  ScheduleDelayedEvent(retry, cps->initDone ? 1 : FEATURE_TIMEOUT); // [HGM] pool: spare engines are already done
 	}
 	return 1;
     }
@@ -14075,6 +15463,7 @@ TwoMachinesEvent P((void))
     }
 
     gameMode = TwoMachinesPlay;
+    StartUsage(&first); StartUsage(&second); // [HGM] cpu: so we can tell what this game cost
     pausing = startingEngine = FALSE;
     ModeHighlight(); // [HGM] logo: this triggers display update of logos
     SetGameInfo();
@@ -15614,7 +17003,8 @@ GetInfoFromComment (int index, char * text)
     if( text != NULL && index > 0 ) {
         int score = 0;
         int depth = 0;
-        int time = -1, sec = 0, deci;
+        int time = -1, sec = 0, deci, n1 = 0, n2 = 0;
+        long usec = 0;
         char * s_eval = FindStr( text, "[%eval " );
         char * s_emt = FindStr( text, "[%emt " );
 #if 0
@@ -15660,9 +17050,9 @@ GetInfoFromComment (int index, char * text)
                *p = '\n'; while(*p == ' ' || *p == '\n') p++; *--p = '{';
                // we now moved the brace to behind the PV: "(.*) {+0.23/6 ..."
             }
-            time = -1; sec = -1; deci = -1;
+            time = -1; sec = -1; deci = -1; usec = 0;
             if( sscanf( p+1, "%d.%d/%d %d:%d", &score, &score_lo, &depth, &time, &sec ) != 5 &&
-		sscanf( p+1, "%d.%d/%d %d.%d", &score, &score_lo, &depth, &time, &deci ) != 5 &&
+		sscanf( p+1, "%d.%d/%d %d.%n%d%n", &score, &score_lo, &depth, &time, &n1, &deci, &n2 ) != 5 &&
                 sscanf( p+1, "%d.%d/%d %d", &score, &score_lo, &depth, &time ) != 4 &&
                 sscanf( p+1, "%d.%d/%d", &score, &score_lo, &depth ) != 3   ) {
                 return text;
@@ -15672,6 +17062,7 @@ GetInfoFromComment (int index, char * text)
                 return text;
             }
 
+            if(deci >= 0 && n2 - n1 == 3) usec = 1000L*(1000*time + deci), deci /= 100; // [HGM] usec: msec precision
             if(sec >= 0) time = 600*time + 10*sec; else
             if(deci >= 0) time = 10*time + deci; else time *= 10; // deci-sec
 
@@ -15699,12 +17090,74 @@ GetInfoFromComment (int index, char * text)
         pvInfoList[index-1].depth = depth;
         pvInfoList[index-1].score = score;
         pvInfoList[index-1].time  = 10*time; // centi-sec
+        pvInfoList[index-1].usec  = usec;
         if(*sep == '}') *sep = 0; else *--sep = '{';
         if(p != text) { while(*p++ = *sep++); sep = text; } // squeeze out space between PV and comment, and return both
     }
     return sep;
 }
 
+// [HGM] latency: response times of engines are kept in histograms with logarithmic bucket size,
+//                values below 4 usec get a bucket each, above that 4 buckets per doubling
+
+static int
+LatencyBucket (long us)
+{
+    int e = 0;
+    if(us < 4) return us < 0 ? 0 : us;
+    while((us >> e) >= 8) e++;
+    us = 4*e + (us >> e);
+    return us < LATENCY_BUCKETS ? us : LATENCY_BUCKETS - 1;
+}
+
+static void
+AddLatency (Latency *h, TimeMark *now, TimeMark *then)
+{
+    long us = 1000000L*(now->sec - then->sec) + (now->us - then->us);
+    h->bucket[LatencyBucket(us)]++;
+    h->n++;
+}
+
+long
+LatencyPercentile (Latency *h, int percent)
+{   // returns middle of the bucket that contains the requested percentile, in usec
+    int i, sum = 0, e, m;
+    if(h->n == 0) return -1;
+    for(i=0; i<LATENCY_BUCKETS-1; i++) if((sum += h->bucket[i])*100L >= (long)percent*h->n) break;
+    if(i < 4) return i;
+    e = (i - 4)/4; m = 4 + (i - 4)%4;
+    return (2*m + 1) << e >> 1;
+}
+
+static void
+EndLatency (ChessProgramState *cps)
+{
+    TimeMark now;
+    if(!cps->moveTimed) return;
+    GetTimeMark(&now);
+    AddLatency(&cps->moveLatency, &now, &cps->moveSent);
+    cps->moveTimed = FALSE;
+}
+
+void
+ReportLatency (ChessProgramState *cps)
+{   // [HGM] latency: export percentiles to debug file and -latencyFile, and start collecting anew
+    char buf[MSG_SIZ];
+    FILE *f;
+    if(cps->moveLatency.n + cps->pingLatency.n == 0) return;
+    snprintf(buf, MSG_SIZ, "%s: move n=%d p50=%.3fms p99=%.3fms, ping n=%d p50=%.3fms p99=%.3fms\n",
+	     cps->tidy ? cps->tidy : cps->which,
+	     cps->moveLatency.n, LatencyPercentile(&cps->moveLatency, 50)/1000., LatencyPercentile(&cps->moveLatency, 99)/1000.,
+	     cps->pingLatency.n, LatencyPercentile(&cps->pingLatency, 50)/1000., LatencyPercentile(&cps->pingLatency, 99)/1000.);
+    if(appData.debugMode) fprintf(debugFP, "latency %s", buf);
+    if(appData.latencyFile && *appData.latencyFile && (f = fopen(appData.latencyFile, "a"))) {
+	fputs(buf, f);
+	fclose(f);
+    }
+    memset(&cps->moveLatency, 0, sizeof(Latency));
+    memset(&cps->pingLatency, 0, sizeof(Latency));
+}
+
 void
 SendToProgram (char *message, ChessProgramState *cps)
 {
@@ -15714,6 +17167,11 @@ SendToProgram (char *message, ChessProgramState *cps)
     if (cps->pr == NoProc) return;
     Attention(cps);
 
+    // [HGM] latency: note when the engine was asked for a move, or for a pong
+    if(!strncmp(message, "ping ", 5)) GetTimeMark(&cps->pingSent), cps->pingTimed = TRUE; else
+    if(!strcmp(message, "go\n")) GetTimeMark(&cps->moveSent), cps->moveTimed = TRUE; else
+    if(!strcmp(message, "force\n")) cps->moveTimed = FALSE;
+
     if (appData.debugMode) {
 	TimeMark now;
 	GetTimeMark(&now);
@@ -15727,7 +17185,7 @@ SendToProgram (char *message, ChessProgramState *cps)
     }
 
     count = strlen(message);
-    outCount = OutputToProcess(cps->pr, message, count, &error);
+    outCount = cps->uci ? UCIToEngine(cps, message, &error) : OutputToProcess(cps->pr, message, count, &error);
     if (outCount < count && !exiting
                          && !endingGame) { /* [HGM] crash: to not hang GameEnds() writing to deceased engines */
       if(!cps->initDone) return; // [HGM] should not generate fatal error during engine load
@@ -15802,7 +17260,7 @@ ReceiveFromProgram (InputSourceRef isr, VOIDSTAR closure, char *message, int cou
 	TimeMark now; int print = 1;
 	char *quote = ""; char c; int i;
 
-	if(appData.engineComments != 1) { /* [HGM] debug: decide if protocol-violating output is written */
+	if(appData.engineComments != 1 && !cps->uci) { /* [HGM] debug: decide if protocol-violating output is written */
 		char start = message[0];
 		if(start >='A' && start <= 'Z') start += 'a' - 'A'; // be tolerant to capitalizing
 		if(sscanf(message, "%d%c%d%d%d", &i, &c, &i, &i, &i) != 5 &&
@@ -15840,6 +17298,7 @@ ReceiveFromProgram (InputSourceRef isr, VOIDSTAR closure, char *message, int cou
             strstr(message, "tellics") != NULL) return;
     }
 
+    if(cps->uci) UCIFromEngine(cps, message); else // [HGM] uci: translate native UCI output first
     HandleMachineMove(message, cps);
 }
 
@@ -16265,7 +17724,7 @@ ShowThinkingEvent ()
     static int oldState = 2; // kludge alert! Neither true nor fals, so first time oldState is always updated
     int newState = appData.showThinking
 	// [HGM] thinking: other features now need thinking output as well
-	|| !appData.hideThinkingFromHuman || appData.adjudicateLossThreshold != 0 || EngineOutputIsUp();
+	|| !appData.hideThinkingFromHuman || appData.adjudicateLossThreshold != 0 || appData.adjudicateDrawThreshold > 0 || EngineOutputIsUp();
 
     if (oldState == newState) return;
     oldState = newState;
@@ -16556,6 +18015,15 @@ DisplayBothClocks ()
 void
 GetTimeMark (TimeMark *tm)
 {
+#if HAVE_CLOCK_GETTIME && defined(CLOCK_MONOTONIC)
+    /* [HGM] usec: monotonic, so that the clocks are not upset when the system time is set */
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    tm->sec = (long) ts.tv_sec;
+    tm->us = (int) (ts.tv_nsec / 1000L);
+
+#else /*!HAVE_CLOCK_GETTIME*/
 #if HAVE_GETTIMEOFDAY
 
     struct timeval timeVal;
@@ -16563,7 +18031,7 @@ GetTimeMark (TimeMark *tm)
 
     gettimeofday(&timeVal, &timeZone);
     tm->sec = (long) timeVal.tv_sec;
-    tm->ms = (int) (timeVal.tv_usec / 1000L);
+    tm->us = (int) timeVal.tv_usec;
 
 #else /*!HAVE_GETTIMEOFDAY*/
 #if HAVE_FTIME
@@ -16573,11 +18041,12 @@ GetTimeMark (TimeMark *tm)
 
     ftime(&timeB);
     tm->sec = (long) timeB.time;
-    tm->ms = (int) timeB.millitm;
+    tm->us = 1000 * (int) timeB.millitm;
 
 #else /*!HAVE_FTIME && !HAVE_GETTIMEOFDAY*/
     tm->sec = (long) time(NULL);
-    tm->ms = 0;
+    tm->us = 0;
+#endif
 #endif
 #endif
 }
@@ -16589,7 +18058,21 @@ long
 SubtractTimeMarks (TimeMark *tm2, TimeMark *tm1)
 {
     return 1000L*(tm2->sec - tm1->sec) +
-           (long) (tm2->ms - tm1->ms);
+           (long) (tm2->us - tm1->us) / 1000;
+}
+
+/* [HGM] usec: same, but carry the fraction of a millisecond that was left over in *residue (in usec)
+   to the next time the clock is decremented, so that it does not get lost on every clock tick
+*/
+static long
+SubtractTimeMarksExact (TimeMark *tm2, TimeMark *tm1, int *residue)
+{
+    long sec = tm2->sec - tm1->sec;
+    int us = tm2->us - tm1->us + *residue;
+
+    while (us < 0) us += 1000000, sec--;
+    *residue = us % 1000;
+    return 1000L*sec + us / 1000;
 }
 
 
@@ -16605,6 +18088,7 @@ SubtractTimeMarks (TimeMark *tm2, TimeMark *tm1)
 
 static TimeMark tickStartTM;
 static long intendedTickLength;
+static int whiteResidue, blackResidue, moveResidue; // [HGM] usec: sub-msec parts of time used, and at start of move
 
 long
 NextTickLength (long timeRemaining)
@@ -16652,6 +18136,8 @@ ResetClocks ()
 	whiteFlag = blackFlag = FALSE;
     }
     lastWhite = lastBlack = whiteStartMove = blackStartMove = 0;
+    whiteResidue = blackResidue = moveResidue = 0;
+    clockUsed[0] = clockUsed[1] = 0;
     DisplayBothClocks();
     adjustedClock = FALSE;
 }
@@ -16671,7 +18157,7 @@ DecrementClocks ()
 
     GetTimeMark(&now);
 
-    lastTickLength = SubtractTimeMarks(&now, &tickStartTM);
+    lastTickLength = SubtractTimeMarksExact(&now, &tickStartTM, WhiteOnMove(forwardMostMove) ? &whiteResidue : &blackResidue);
 
     /* Fudge if we woke up a little too soon */
     fudge = intendedTickLength - lastTickLength;
@@ -16759,21 +18245,28 @@ SwitchClocks (int newMoveNr)
     GetTimeMark(&now);
 
     if (StopClockTimer() && appData.clockMode) {
-	lastTickLength = SubtractTimeMarks(&now, &tickStartTM);
 	if (!WhiteOnMove(forwardMostMove)) {
+	    lastTickLength = SubtractTimeMarksExact(&now, &tickStartTM, &blackResidue);
 	    if(blackNPS >= 0) lastTickLength = 0;
 	    blackTimeRemaining -= lastTickLength;
+	    clockUsed[1] += clockStart - blackTimeRemaining;
            /* [HGM] PGNtime: save time for PGN file if engine did not give it */
 //         if(pvInfoList[forwardMostMove].time == -1)
                  pvInfoList[forwardMostMove].time =               // use GUI time
                       (timeRemaining[1][forwardMostMove-1] - blackTimeRemaining)/10;
+                 pvInfoList[forwardMostMove].usec = blackNPS >= 0 ? 0 :
+                      1000L*(timeRemaining[1][forwardMostMove-1] - blackTimeRemaining) + blackResidue - moveResidue;
 	} else {
+	   lastTickLength = SubtractTimeMarksExact(&now, &tickStartTM, &whiteResidue);
 	   if(whiteNPS >= 0) lastTickLength = 0;
 	   whiteTimeRemaining -= lastTickLength;
+	   clockUsed[0] += clockStart - whiteTimeRemaining;
            /* [HGM] PGNtime: save time for PGN file if engine did not give it */
 //         if(pvInfoList[forwardMostMove].time == -1)
                  pvInfoList[forwardMostMove].time =
                       (timeRemaining[0][forwardMostMove-1] - whiteTimeRemaining)/10;
+                 pvInfoList[forwardMostMove].usec = whiteNPS >= 0 ? 0 :
+                      1000L*(timeRemaining[0][forwardMostMove-1] - whiteTimeRemaining) + whiteResidue - moveResidue;
 	}
 	flagged = CheckFlags();
     }
@@ -16805,6 +18298,8 @@ SwitchClocks (int newMoveNr)
     }
 
     tickStartTM = now;
+    moveResidue = WhiteOnMove(forwardMostMove) ? whiteResidue : blackResidue;
+    clockStart = WhiteOnMove(forwardMostMove) ? whiteTimeRemaining : blackTimeRemaining;
     intendedTickLength = NextTickLength(WhiteOnMove(forwardMostMove) ?
       whiteTimeRemaining : blackTimeRemaining);
     StartClockTimer(intendedTickLength);
@@ -16823,14 +18318,16 @@ StopClocks ()
 
     GetTimeMark(&now);
 
-    lastTickLength = SubtractTimeMarks(&now, &tickStartTM);
+    lastTickLength = SubtractTimeMarksExact(&now, &tickStartTM, WhiteOnMove(forwardMostMove) ? &whiteResidue : &blackResidue);
     if (WhiteOnMove(forwardMostMove)) {
 	if(whiteNPS >= 0) lastTickLength = 0;
 	whiteTimeRemaining -= lastTickLength;
+	clockUsed[0] += clockStart - whiteTimeRemaining;
 	DisplayWhiteClock(whiteTimeRemaining, WhiteOnMove(currentMove));
     } else {
 	if(blackNPS >= 0) lastTickLength = 0;
 	blackTimeRemaining -= lastTickLength;
+	clockUsed[1] += clockStart - blackTimeRemaining;
 	DisplayBlackClock(blackTimeRemaining, !WhiteOnMove(currentMove));
     }
     CheckFlags();
@@ -16849,6 +18346,8 @@ StartClocks ()
     if (gameMode == AnalyzeMode || gameMode == AnalyzeFile) return;
 
     GetTimeMark(&tickStartTM);
+    moveResidue = WhiteOnMove(forwardMostMove) ? whiteResidue : blackResidue;
+    clockStart = WhiteOnMove(forwardMostMove) ? whiteTimeRemaining : blackTimeRemaining;
     intendedTickLength = NextTickLength(WhiteOnMove(forwardMostMove) ?
       whiteTimeRemaining : blackTimeRemaining);
 
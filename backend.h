@@ -337,6 +337,19 @@ typedef struct XB_OPT {   // [HGM] options: descriptor of UCI-style option
     char *name;         // holds both option name and text value (in allocated memory)
 } Option;
 
+/* A point in time */
+typedef struct {
+    long sec;  /* Assuming this is >= 32 bits */
+    int us;    /* microseconds; assuming this is >= 32 bits */
+} TimeMark;
+
+#define LATENCY_BUCKETS 128
+
+typedef struct { /* [HGM] latency: histogram of response times, 4 buckets per factor 2 */
+    int n;
+    int bucket[LATENCY_BUCKETS];
+} Latency;
+
 typedef struct XB_CPS {
     char *which;
     int maybeThinking;
@@ -409,6 +422,14 @@ typedef struct XB_CPS {
     char *fenOverride; /* [HGM} FRC: force FEN casling & ep fields by hand  */
     char userError;    /* [HGM] crash: flag to suppress fatal-error messages*/
     char reload;       /* [HGM] options: flag to resend options with xreuse */
+    char usageValid;   /* [HGM] cpu: 1 = usageStart taken at game start, 2 = gameUsage measured at game end */
+    int playerNr;      /* [HGM] cpu: tourney participant this engine plays for, or -1 */
+    char *affinity;    /* [HGM] affinity: list of CPUs to run on, like "0,2-3" */
+    ProcUsage usageStart, gameUsage;
+    char moveTimed, pingTimed; /* [HGM] latency: we are waiting for a move / pong, sent at the time below */
+    TimeMark moveSent, pingSent;
+    Latency moveLatency, pingLatency;
+    void *uci;         /* [HGM] uci: state of built-in UCI translation, NULL if engine talks CECP (or through adapter) */
 } ChessProgramState;
 
 extern ChessProgramState first, second;
@@ -447,13 +468,14 @@ void MakeEngineOutputTitle P((void));
 void LoadTheme P((void));
 void CreateBookEvent P((void));
 
-/* A point in time */
-typedef struct {
-    long sec;  /* Assuming this is >= 32 bits */
-    int ms;    /* Assuming this is >= 16 bits */
-} TimeMark;
-
 void GetTimeMark P((TimeMark *));
 long SubtractTimeMarks P((TimeMark *, TimeMark *));
+long LatencyPercentile P((Latency *h, int percent));
+void HandleMachineMove P((char *message, ChessProgramState *cps));
+char *StandingsText P((int display, int crossTable));
+char *TourneyDashboard P((void));
+void UCIStart P((ChessProgramState *cps));
+int UCIToEngine P((ChessProgramState *cps, char *message, int *outError));
+void UCIFromEngine P((ChessProgramState *cps, char *line));
 
 #endif /* XB_BACKEND */
@@ -292,6 +292,12 @@ typedef enum {
     ColorNone, NColorClasses
 } ColorClass;
 
+typedef struct { /* [HGM] cpu: resources used by an engine process */
+    long userTime, sysTime;          /* in msec */
+    long maxRSS;                     /* peak resident set, in kB */
+    long volSwitches, involSwitches; /* context switches */
+} ProcUsage;
+
 typedef enum {
     SoundMove, SoundBell, SoundAlarm, SoundIcsWin, SoundIcsLoss,
     SoundIcsDraw, SoundIcsUnfinished, NSoundClasses
@@ -578,6 +584,10 @@ typedef struct {
     int fontPieceSize; /* Size of font relative to square (percentage) */
     int overrideLineGap; /* If >= 0 overrides the lineGap value of the board size properties */
     int adjudicateLossThreshold; /* Adjudicate a two-machine game if both engines agree the score is below this for 6 plies */
+    int adjudicateLossPlies;     /* ... or for this many plies */
+    int adjudicateDrawThreshold; /* Adjudicate a draw if both engines report |score| <= this ... */
+    int adjudicateDrawPlies;     /* ... for this many consecutive plies ... */
+    int adjudicateDrawStart;     /* ... after this move number */
     int delayBeforeQuit;
     int delayAfterQuit;
     char * nameOfDebugFile;
@@ -603,6 +613,7 @@ typedef struct {
     Boolean isUCI[ENGINES];
     Boolean hasOwnBookUCI[ENGINES];
     char * adapterCommand;
+    Boolean nativeUCI;
     char * ucciAdapter;
     char * polyglotDir;
     Boolean usePolyglotBook;
@@ -663,6 +674,7 @@ typedef struct {
     int timeOddsMode;
     int accumulateTC[ENGINES];
     int NPS[ENGINES];
+    char *affinity[ENGINES];
     Boolean autoKibitz;
     int engineComments;
     int eloThreshold1;  /* [HGM] select   */
@@ -717,9 +729,21 @@ typedef struct {
     int tourneyType;
     int tourneyCycles;
     int seedBase;
+    int concurrency;
+    int workerNr;
+    Boolean autoAffinity;
+    int enginePool;
     Boolean roundSync;
     Boolean cycleSync;
     Boolean numberTag;
+    Boolean cpuTags;
+    char *latencyFile;
+    char *standingsFile;
+    char *matchLog;
+    char *sprt;
+    Boolean openingSuite;
+    int openingSeed;
+    Boolean tablebaseAdjudication;
 } AppData, *AppDataPtr;
 
 /*  PGN tags (for showing in the game list) */
@@ -776,7 +800,8 @@ typedef struct {
 typedef struct {
     int score;  /* Centipawns */
     int depth;  /* Plies */
-    int time;   /* Milliseconds */
+    int time;   /* Centiseconds */
+    long usec;  /* [HGM] usec: GUI-measured time in microseconds, 0 if unknown */
 } ChessProgramStats_Move;
 
 /* [AS] Layout management */
@@ -839,6 +864,8 @@ void DisplayError P((String message, int error));
 #define secondIsUCI  isUCI[1]
 #define firstNPS     NPS[0]
 #define secondNPS    NPS[1]
+#define firstAffinity  affinity[0]
+#define secondAffinity affinity[1]
 #define firstLogo    logo[0]
 #define secondLogo   logo[1]
 #define fenOverride1 fenOverride[0]
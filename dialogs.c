@@ -1086,6 +1086,41 @@ EditTagsProc ()
   if (bookUp || !PopDown(TagsDlg)) EditTagsEvent();
 }
 
+//---------------------------------------------- Tourney Dashboard ------------------------------
+
+static char *dashboardText;
+static void RefreshDashboard P((int n));
+
+static Option dashboardOptions[] = {
+{ 300, T_VSCRL | T_HSCRL | T_FILL | T_TOP, 500, NULL, (void*) &dashboardText, "", NULL, TextBox, "" },
+{   0,     0, 100, NULL, (void*) &RefreshDashboard, NULL, NULL, Button, N_("Refresh") },
+{   0, SAME_ROW | NO_OK, 0, NULL, NULL, "", NULL, EndMark , "" }
+};
+
+static void
+RefreshDashboard (int n)
+{
+    char *text = TourneyDashboard();
+    SetWidgetText(&dashboardOptions[0], text, TourneyDlg);
+    free(text);
+}
+
+void
+TourneyDashboardUpdate ()
+{   // called by back-end when a tourney game is reserved or finished
+    if(shellUp[TourneyDlg]) RefreshDashboard(0);
+}
+
+void
+TourneyDashboardProc ()
+{
+    if(PopDown(TourneyDlg)) return;
+    FREE(dashboardText); dashboardText = TourneyDashboard();
+    if(DialogExists(TourneyDlg)) SetWidgetText(&dashboardOptions[0], dashboardText, TourneyDlg);
+    GenericPopUp(dashboardOptions, _("Tourney Dashboard"), TourneyDlg, BoardWindow, NONMODAL, appData.topLevel);
+    MarkMenu("View.TourneyDashboard", TourneyDlg);
+}
+
 //---------------------------------------------- ICS Input Box ----------------------------------
 
 char *icsText;
@@ -1902,7 +1937,7 @@ DisplayFatalError (String message, int error, int status)
 	snprintf(buf, sizeof(buf), "%s: %s", message, strerror(error));
 	message = buf;
     }
-    if(mainOptions[W_BOARD].handle) {
+    if(mainOptions[W_BOARD].handle || (appData.noGUI && MainWindowUp())) { // [HGM] nogui: without display there is no window
 	if (appData.popupExitMessage) {
 	    ErrorPopUp(status ? _("Fatal Error") : _("Exiting"), message, TRUE);
 	} else {
@@ -101,6 +101,7 @@ CommentDlg, TagsDlg, TextMenuDlg, InputBoxDlg, ChatDlg, DummyDlg, HistoryDlg, //
 GameListDlg,
 EngOutDlg,
 EvalGraphDlg,
+TourneyDlg,
 PromoDlg,       // this and beyond are destroyed at pop-down
 ErrorDlg,
 AskDlg,         // this and beyond do grab mouse events (and are destroyed)
@@ -513,6 +513,15 @@ UpdateControls (EngineOutputData *ed)
         }
     }
 
+    { // [HGM] latency: median and worst-percentile round trip of pings, to tell engine slowness from communication overhead
+	Latency *h = &(ed->which ? &second : &first)->pingLatency;
+	if( h->n > 0 ) {
+	    int len = strlen(s_label);
+	    snprintf( s_label + len, sizeof(s_label) - len, "%s%s: %.2f/%.2fms", len ? "  " : "", _("ping"),
+		      LatencyPercentile(h, 50)/1000., LatencyPercentile(h, 99)/1000. );
+	}
+    }
+
     DoSetWindowText( ed->which, nLabelNPS, s_label );
 
     /* Memo */
@@ -110,6 +110,7 @@ void DoSleep P((int n));
 
 char *UserName P((void));
 char *HostName P((void));
+char *HelperProgram P((void));
 
 int ClockTimerRunning P((void));
 int StopClockTimer P((void));
@@ -137,6 +138,9 @@ int  RightClick P((ClickType c, int x, int y, int *col, int *row));
 
 int StartChildProcess P((char *cmdLine, char *dir, ProcRef *pr));
 void DestroyChildProcess P((ProcRef pr, int/*boolean*/ signal));
+int GetProcessUsage P((ProcRef pr, ProcUsage *usage));
+void SetChildAffinity P((char *cpuList));
+int NumberOfCPUs P((void));
 void InterruptChildProcess P((ProcRef pr));
 void RunCommand P((char *buf));
 
@@ -199,6 +203,7 @@ void ClearPremoveHighlights P((void));
 void AnimateAtomicCapture P((Board board, int fromX, int fromY, int toX, int toY));
 void ShutDownFrontEnd P((void));
 void BoardToTop P((void));
+int  MainWindowUp P((void));
 void AnimateMove P((Board board, int fromX, int fromY, int toX, int toY));
 void HistorySet P((char movelist[][2*MOVE_LEN], int first, int last, int current));
 void FreezeUI P((void));
@@ -235,6 +240,7 @@ Boolean EvalGraphIsUp P((void));
 int  EvalGraphDialogExists P((void));
 void SlavePopUp P((void));
 void ActivateTheme P((int new));
+void TourneyDashboardUpdate P((void));
 char *Col2Text P((int n));
 
 /* these are in xhistory.c  */
@@ -1856,7 +1856,7 @@ typedef struct {
     CPKind kind;
     int fd;
     int lineByLine;
-    char *unused;
+    LineBuffer lines;
     InputCallback func;
     guint sid;
     char buf[INPUT_SOURCE_BUF_SIZE];
@@ -1875,7 +1875,6 @@ DoInputCallback(io, cond, data)
 
     int count;
     int error;
-    char *p, *q;
 
     /* All information (callback function, file descriptor, etc) is
      * saved in an InputSource structure
@@ -1883,30 +1882,10 @@ DoInputCallback(io, cond, data)
     InputSource *is = (InputSource *) data;
 
     if (is->lineByLine) {
-	count = read(is->fd, is->unused,
-		     INPUT_SOURCE_BUF_SIZE - (is->unused - is->buf));
-	if (count <= 0) {
-	    (is->func)(is, is->closure, is->buf, count, count ? errno : 0);
-	    return True;
-	}
-	is->unused += count;
-	p = is->buf;
 	/* break input into lines and call the callback function on each
 	 * line
 	 */
-	while (p < is->unused) {
-	    q = memchr(p, '\n', is->unused - p);
-	    if (q == NULL) break;
-	    q++;
-	    (is->func)(is, is->closure, p, q - p, 0);
-	    p = q;
-	}
-	/* remember not yet used part of the buffer */
-	q = is->buf;
-	while (p < is->unused) {
-	    *q++ = *p++;
-	}
-	is->unused = q;
+	ReadLines(is, is->fd, &is->lines, is->func, is->closure);
     } else {
       /* read maximum length of input buffer and send the whole buffer
        * to the callback function
@@ -1941,11 +1920,6 @@ InputSourceRef AddInputSource(pr, lineByLine, func, closure)
 	is->kind = cp->kind;
 	is->fd = cp->fdFrom;
     }
-    if (lineByLine)
-      is->unused = is->buf;
-    else
-      is->unused = NULL;
-
    /* GTK-TODO: will this work on windows?*/
 
     channel = g_io_channel_unix_new(is->fd);
@@ -153,6 +153,7 @@ void LoadEngine2Proc P((void));
 void FirstSettingsProc P((void));
 void SecondSettingsProc P((void));
 void GameListOptionsProc P((void));
+void TourneyDashboardProc P((void));
 void IcsOptionsProc P((void));
 void SoundOptionsProc P((void));
 void BoardOptionsProc P((void));
@@ -71,6 +71,7 @@ int PosFlags(int index);
 
 extern signed char initialRights[BOARD_FILES]; /* [HGM] all rights enabled, set in InitPosition */
 int quickFlag;
+int genDone; // [HGM] speed: set by a callback that has seen enough, to skip all further moves
 
 int
 WhitePiece (ChessSquare piece)
@@ -166,6 +167,335 @@ CompareBoards (Board board1, Board board2)
 }
 
 
+/* [HGM] speed: the moves of each piece type are compiled from the rules of the current variant
+   into a list of steps, so that the move generator does not have to figure out over and over
+   again which variant it is playing, and how its pieces move there. A step is a leap, or a ride
+   of up to 'range' leaps in the same direction, further restricted by the mode flags below.  */
+
+#define M_NOCAPT   0x001 /* step only to empty squares                                      */
+#define M_CAPT     0x002 /* step only to squares occupied by an enemy                        */
+#define M_KRIEG    0x004 /* ... or to any square when capturing invisible pieces (Kriegspiel) */
+#define M_LAME     0x008 /* square (br, bf) relative to the piece must be empty                */
+#define M_SCREEN   0x010 /* square (br, bf) relative to the piece must be occupied             */
+#define M_RIVER    0x020 /* step must not cross the river (Xiangqi Elephant)                   */
+#define M_PALACE   0x040 /* step must stay in the Palace (Xiangqi King and Advisor)            */
+#define M_HOP      0x080 /* step must hop over exactly one piece to capture (Cannon)           */
+#define M_EP       0x100 /* e.p. capture of a Pawn next to us                                  */
+#define M_NULL     0x200 /* move to the square the piece is already on (wildcard pieces)       */
+#define M_PROMO    0x400 /* step is a promotion (of type kind) when starting in the zone        */
+
+#define RIDER  (BOARD_RANKS + BOARD_FILES) /* range of a slider without range limit */
+
+typedef struct {
+    signed char dr, df;  /* step vector in ranks and files */
+    unsigned char range; /* 1 for leapers, 0 terminates the list */
+    short mode;          /* M_XXX flags */
+    signed char br, bf;  /* square that must be empty (M_LAME) or occupied (M_SCREEN) */
+    signed char lo, hi;  /* ranks the piece must be on to take this step */
+    signed char zone;    /* depth of the promotion zone, counted back from the last rank (M_PROMO) */
+    ChessMove kind;      /* move type to generate */
+} MoveStep;
+
+static MoveStep stepPool[24*EmptySquare], *moveTable[EmptySquare], *nextStep;
+static int tableVariant = -1, tableHeight;
+
+static MoveStep *
+AddStep (int dr, int df, int range, int mode)
+{
+    MoveStep *s = nextStep++;
+
+    s->dr = dr; s->df = df; s->range = range; s->mode = mode;
+    s->br = s->bf = 0;
+    s->lo = 0; s->hi = BOARD_HEIGHT-1;
+    s->zone = 0;
+    s->kind = NormalMove;
+    return s;
+}
+
+/* the steps of each family are added in a fixed order, as callers like Disambiguate can depend on move order */
+
+static void
+AddKnight (int range, int lame)
+{
+    int i, j, s;
+    for (i = -1; i <= 1; i += 2)
+	for (j = -1; j <= 1; j += 2)
+	    for (s = 1; s <= 2; s++) {
+		MoveStep *step = AddStep(i*s, j*(3-s), range, lame ? M_LAME : 0);
+		step->br = i*(s-1); step->bf = j*(2-s); // [HGM] Xiangqi Horse is blocked next to it
+	    }
+}
+
+static void
+AddOrthogonal (int dist, int range, int mode)
+{
+    int d, s;
+    for (d = 0; d <= 1; d++)
+	for (s = -dist; s <= dist; s += 2*dist) {
+	    MoveStep *step = AddStep(s*d, s*(1-d), range, mode);
+	    step->br = step->dr/2; step->bf = step->df/2; // Dababba jumps over this
+	}
+}
+
+static void
+AddDiagonal (int range, int mode)
+{
+    int rs, fs;
+    for (rs = -1; rs <= 1; rs += 2)
+	for (fs = -1; fs <= 1; fs += 2) AddStep(rs, fs, range, mode);
+}
+
+static void
+AddAllRound (int range)
+{
+    int rs, fs;
+    for (rs = -1; rs <= 1; rs++)
+	for (fs = -1; fs <= 1; fs++) if(rs || fs) AddStep(rs, fs, range, 0);
+}
+
+/* Pawn step, which promotes when it starts promoRank ranks or less from the far end */
+static void
+AddPawnStep (int dr, int df, int mode, int promoRank)
+{
+    MoveStep *step = AddStep(dr, df, 1, mode | M_PROMO);
+
+    step->zone = promoRank;
+    step->kind = dr > 0 ? WhitePromotion : BlackPromotion;
+}
+
+static void
+CompilePiece (ChessSquare p)
+{
+    int fw = p < BlackPawn ? 1 : -1, s, piece = p;
+    int xq = gameInfo.variant == VariantXiangqi, palace = xq ? M_PALACE : 0;
+    int promoRank = gameInfo.variant == VariantMakruk || gameInfo.variant == VariantGrand ? 3 : 1;
+    MoveStep *step;
+
+    if(gameInfo.variant == VariantShogi) piece = SHOGI p;
+
+    moveTable[p] = nextStep;
+    switch (piece) {
+      default:
+	/* can't happen ([HGM] except for faries...) */
+	break;
+
+      case WhitePawn:
+      case BlackPawn:
+	if(xq) {
+	    /* [HGM] capture and move straight ahead in Xiangqi, and sideways when across the river */
+	    AddStep(fw, 0, 1, 0);
+	    for (s = -1; s <= 1; s += 2) {
+		step = AddStep(0, s, 1, 0);
+		if(fw > 0) step->lo = BOARD_HEIGHT>>1; else step->hi = (BOARD_HEIGHT>>1) - 1;
+	    }
+	    break;
+	}
+	AddPawnStep(fw, 0, M_NOCAPT, promoRank);
+	if(gameInfo.variant != VariantShatranj && gameInfo.variant != VariantCourier) { /* [HGM] */
+	    step = AddStep(2*fw, 0, 1, M_NOCAPT | M_LAME); // [HGM] grand: also on 3rd rank on 10-board
+	    step->br = fw;
+	    if(fw > 0) step->hi = (BOARD_HEIGHT>>1) - 3; else step->lo = ((BOARD_HEIGHT+1)>>1) + 2;
+	}
+	for (s = -1; s <= 1; s += 2) {
+	    AddPawnStep(fw, s, M_CAPT | M_KRIEG, promoRank);
+	    step = AddStep(fw, s, 1, M_EP);
+	    step->kind = fw > 0 ? WhiteCapturesEnPassant : BlackCapturesEnPassant;
+	    if(fw > 0) step->lo = (BOARD_HEIGHT+1)>>1, step->hi = BOARD_HEIGHT-4; // [HGM] grand: 4th & 5th rank on 10-board
+	    else       step->lo = 3, step->hi = (BOARD_HEIGHT>>1) - 1;
+	}
+	break;
+
+      case WhiteUnicorn:
+      case BlackUnicorn:
+      case WhiteKnight:
+      case BlackKnight:
+	AddKnight(1, xq);
+	break;
+
+      case SHOGI WhiteKnight:
+      case SHOGI BlackKnight:
+	for (s = -1; s <= 1; s += 2) AddStep(2*fw, s, 1, 0);
+	break;
+
+      case WhiteCannon:
+      case BlackCannon:
+	AddOrthogonal(1, RIDER, M_HOP);
+	break;
+
+      /* Gold General (and all its promoted versions). First do the */
+      /* diagonal forward steps, then proceed as normal Wazir        */
+      case SHOGI WhiteWazir:
+      case SHOGI (PROMOTED WhitePawn):
+      case SHOGI (PROMOTED WhiteKnight):
+      case SHOGI (PROMOTED WhiteQueen):
+      case SHOGI (PROMOTED WhiteFerz):
+      case SHOGI BlackWazir:
+      case SHOGI (PROMOTED BlackPawn):
+      case SHOGI (PROMOTED BlackKnight):
+      case SHOGI (PROMOTED BlackQueen):
+      case SHOGI (PROMOTED BlackFerz):
+	for (s = -1; s <= 1; s += 2) AddStep(fw, s, 1, 0);
+      case WhiteWazir:
+      case BlackWazir:
+	AddOrthogonal(1, 1, palace);
+	break;
+
+      case WhiteAlfil:
+      case BlackAlfil:
+	/* [HGM] support Shatranj pieces */
+	{ int rs, fs;
+	  for (rs = -1; rs <= 1; rs += 2)
+	    for (fs = -1; fs <= 1; fs += 2) {
+		step = AddStep(2*rs, 2*fs, 1, xq ? M_LAME | M_RIVER : 0);
+		step->br = rs; step->bf = fs;
+		if(gameInfo.variant == VariantShatranj || gameInfo.variant == VariantCourier || xq) continue; // classical Alfil
+		AddStep(rs, fs, 1, 0); // in unknown variant we assume Modern Elephant, which can also do one step
+	    }
+	}
+	if(gameInfo.variant == VariantSpartan)
+	    for (s = -1; s <= 1; s += 2) AddStep(0, s, 1, M_NOCAPT);
+	break;
+
+      /* Make Dragon-Horse also do Dababba moves outside Shogi, for better disambiguation in variant Fairy */
+      case WhiteCardinal:
+      case BlackCardinal:
+	AddOrthogonal(2, 1, 0);
+      /* Shogi Dragon Horse continues with Wazir after Bishop */
+      case SHOGI WhiteCardinal:
+      case SHOGI BlackCardinal:
+	AddDiagonal(RIDER, 0);
+	AddOrthogonal(1, 1, palace);
+	break;
+
+      /* Capablanca Archbishop continues as Knight */
+      case WhiteAngel:
+      case BlackAngel:
+	AddDiagonal(RIDER, 0);
+	AddKnight(1, xq);
+	break;
+
+      case SHOGI WhiteBishop:
+      case SHOGI BlackBishop:
+      case WhiteBishop:
+      case BlackBishop:
+	AddDiagonal(RIDER, 0);
+	break;
+
+      /* Shogi Lance is unlike anything, and asymmetric at that */
+      case SHOGI WhiteQueen:
+      case SHOGI BlackQueen:
+	AddStep(fw, 0, RIDER, 0);
+	break;
+
+      /* Make Dragon-King Dababba & Rook-like outside Shogi, for better disambiguation in variant Fairy */
+      case WhiteDragon:
+      case BlackDragon:
+	AddOrthogonal(2, 1, M_SCREEN); // Dababba moves that Rook cannot do
+	AddOrthogonal(1, gameInfo.variant == VariantSpartan ? 2 : RIDER, 0); // in Spartan Chess restrict range to modern Dababba
+	break;
+
+      /* Shogi Dragon King continues as Ferz after Rook moves */
+      case SHOGI WhiteDragon:
+      case SHOGI BlackDragon:
+	AddOrthogonal(1, RIDER, 0);
+	AddDiagonal(1, palace);
+	break;
+
+      /* Capablanca Chancellor continues as Knight */
+      case WhiteMarshall:
+      case BlackMarshall:
+	AddOrthogonal(1, RIDER, 0);
+	if(gameInfo.variant == VariantSpartan) AddDiagonal(1, palace); // in Spartan Chess Chancellor is used for Dragon King.
+	else AddKnight(1, xq);
+	break;
+
+      case SHOGI WhiteRook:
+      case SHOGI BlackRook:
+      case WhiteRook:
+      case BlackRook:
+	AddOrthogonal(1, RIDER, 0);
+	break;
+
+      case WhiteQueen:
+      case BlackQueen:
+	AddAllRound(RIDER);
+	break;
+
+      /* Shogi Pawn and Silver General: first the Pawn move,    */
+      /* then the General continues like a Ferz                 */
+      case WhiteMan:
+      case BlackMan:
+	if(gameInfo.variant != VariantMakruk && gameInfo.variant != VariantASEAN) { AddAllRound(1); break; }
+      case SHOGI WhiteFerz:
+      case SHOGI BlackFerz:
+	AddStep(fw, 0, 1, 0);
+      case WhiteFerz:
+      case BlackFerz:
+	AddDiagonal(1, palace);
+	break;
+
+      case SHOGI WhitePawn:
+      case SHOGI BlackPawn:
+	AddStep(fw, 0, 1, 0);
+	break;
+
+      case WhiteSilver: // [HGM] superchess: use for Centaur
+      case BlackSilver:
+	AddAllRound(1);
+	AddKnight(1, xq);
+	break;
+
+      case SHOGI WhiteKing:
+      case SHOGI BlackKing:
+      case WhiteKing:
+      case BlackKing:
+	AddAllRound(1);
+	break;
+
+      case WhiteNightrider:
+      case BlackNightrider:
+	AddKnight(RIDER, 0);
+	break;
+
+      // Use Lance as Berolina / Spartan Pawn.
+      case WhiteLance:
+      case BlackLance:
+	if(gameInfo.variant == VariantSuper) { // Amazon
+	    AddDiagonal(RIDER, 0);
+	    AddOrthogonal(1, RIDER, 0);
+	    AddKnight(1, xq);
+	    break;
+	}
+	AddPawnStep(fw, 0, M_CAPT, promoRank);
+	for (s = -1; s <= 1; s += 2) {
+	    AddPawnStep(fw, s, M_NOCAPT, promoRank);
+	    step = AddStep(2*fw, 2*s, 1, M_NOCAPT);
+	    step->lo = step->hi = fw > 0 ? 1 : BOARD_HEIGHT-2;
+	}
+	break;
+
+      case WhiteFalcon: // [HGM] wild: for wildcards, self-capture symbolizes move to anywhere
+      case BlackFalcon:
+      case WhiteCobra:
+      case BlackCobra:
+	AddStep(0, 0, 1, M_NULL);
+	break;
+    }
+    AddStep(0, 0, 0, 0); // sentinel
+}
+
+/* Compile the move tables of all pieces for the current variant and board size */
+void
+InitMoveTables ()
+{
+    int p;
+
+    nextStep = stepPool;
+    for(p = 0; p < (int) EmptySquare; p++) CompilePiece((ChessSquare) p);
+    tableVariant = gameInfo.variant;
+    tableHeight  = BOARD_HEIGHT;
+}
+
 /* Call callback once for each pseudo-legal move in the given
    position, except castling moves. A move is pseudo-legal if it is
    legal, or if it would be legal except that it leaves the king in
@@ -178,532 +508,81 @@ void
 GenPseudoLegal (Board board, int flags, MoveCallback callback, VOIDSTAR closure, ChessSquare filter)
 // speed: only do moves with this piece type
 {
-    int rf, ff;
-    int i, j, d, s, fs, rs, rt, ft, m;
+    int rf, ff, rt, ft, i, hops;
     int epfile = (signed char)board[EP_STATUS]; // [HGM] gamestate: extract ep status from board
-    int promoRank = gameInfo.variant == VariantMakruk || gameInfo.variant == VariantGrand ? 3 : 1;
+    int height = BOARD_HEIGHT, left = BOARD_LEFT, right = BOARD_RGHT; // callbacks cannot change these
+
+    if(tableVariant != gameInfo.variant || tableHeight != height) InitMoveTables();
 
-    for (rf = 0; rf < BOARD_HEIGHT; rf++)
-      for (ff = BOARD_LEFT; ff < BOARD_RGHT; ff++) {
-          ChessSquare piece;
-          int rookRange;
+    for (rf = 0; rf < height; rf++)
+      for (ff = left; ff < right; ff++) {
+          ChessSquare piece = board[rf][ff], victim;
+          MoveStep *step;
+          int white = piece < BlackPawn;
 
-	  if(board[rf][ff] == EmptySquare) continue;
-	  if ((flags & F_WHITE_ON_MOVE) != (board[rf][ff] < BlackPawn)) continue; // [HGM] speed: wrong color
-	  rookRange = 1000;
-          m = 0; piece = board[rf][ff];
+	  if(piece == EmptySquare) continue;
+	  if ((flags & F_WHITE_ON_MOVE) != white) continue; // [HGM] speed: wrong color
+	  if(genDone) return;
           if(PieceToChar(piece) == '~')
                  piece = (ChessSquare) ( DEMOTED piece );
           if(filter != EmptySquare && piece != filter) continue;
-          if(gameInfo.variant == VariantShogi)
-                 piece = (ChessSquare) ( SHOGI piece );
 
-          switch ((int)piece) {
-            /* case EmptySquare: [HGM] this is nonsense, and conflicts with Shogi cases */
-	    default:
-	      /* can't happen ([HGM] except for faries...) */
-	      break;
-
-             case WhitePawn:
-              if(gameInfo.variant == VariantXiangqi) {
-                  /* [HGM] capture and move straight ahead in Xiangqi */
-                  if (rf < BOARD_HEIGHT-1 &&
-                           !SameColor(board[rf][ff], board[rf + 1][ff]) ) {
-                           callback(board, flags, NormalMove,
-                                    rf, ff, rf + 1, ff, closure);
-                  }
-                  /* and move sideways when across the river */
-                  for (s = -1; s <= 1; s += 2) {
-                      if (rf >= BOARD_HEIGHT>>1 &&
-                          ff + s >= BOARD_LEFT && ff + s < BOARD_RGHT &&
-                          !WhitePiece(board[rf][ff+s]) ) {
-                           callback(board, flags, NormalMove,
-                                    rf, ff, rf, ff+s, closure);
-                      }
-                  }
-                  break;
-              }
-              if (rf < BOARD_HEIGHT-1 && board[rf + 1][ff] == EmptySquare) {
-		  callback(board, flags,
-			   rf >= BOARD_HEIGHT-1-promoRank ? WhitePromotion : NormalMove,
-			   rf, ff, rf + 1, ff, closure);
-	      }
-	      if (rf <= (BOARD_HEIGHT>>1)-3 && board[rf+1][ff] == EmptySquare && // [HGM] grand: also on 3rd rank on 10-board
-                  gameInfo.variant != VariantShatranj && /* [HGM] */
-                  gameInfo.variant != VariantCourier  && /* [HGM] */
-                  board[rf+2][ff] == EmptySquare ) {
-                      callback(board, flags, NormalMove,
-                               rf, ff, rf+2, ff, closure);
-	      }
-	      for (s = -1; s <= 1; s += 2) {
-                  if (rf < BOARD_HEIGHT-1 && ff + s >= BOARD_LEFT && ff + s < BOARD_RGHT &&
-		      ((flags & F_KRIEGSPIEL_CAPTURE) ||
-		       BlackPiece(board[rf + 1][ff + s]))) {
-		      callback(board, flags,
-			       rf >= BOARD_HEIGHT-1-promoRank ? WhitePromotion : NormalMove,
-			       rf, ff, rf + 1, ff + s, closure);
-		  }
-		  if (rf >= BOARD_HEIGHT+1>>1) {// [HGM] grand: 4th & 5th rank on 10-board
-                      if (ff + s >= BOARD_LEFT && ff + s < BOARD_RGHT &&
-			  (epfile == ff + s || epfile == EP_UNKNOWN) && rf < BOARD_HEIGHT-3 &&
-                          board[rf][ff + s] == BlackPawn &&
-                          board[rf+1][ff + s] == EmptySquare) {
-			  callback(board, flags, WhiteCapturesEnPassant,
-				   rf, ff, rf+1, ff + s, closure);
-		      }
+          for (step = moveTable[piece]; step->range; step++) {
+	      int mode = step->mode;
+	      if (rf < step->lo || rf > step->hi) continue;
+	      if (!mode) { /* plain leap or ride: this is what almost all steps are */
+		  int dr = step->dr, df = step->df;
+		  for (i = step->range, rt = rf + dr, ft = ff + df;; rt += dr, ft += df) {
+		      if (rt < 0 || rt >= height || ft < left || ft >= right) break;
+		      victim = board[rt][ft];
+		      if (victim != EmptySquare && (victim < BlackPawn) == white) break; // own piece
+		      callback(board, flags, step->kind, rf, ff, rt, ft, closure);
+		      if (victim != EmptySquare || --i == 0) break;
 		  }
+		  continue;
 	      }
-	      break;
-
-	    case BlackPawn:
-              if(gameInfo.variant == VariantXiangqi) {
-                  /* [HGM] capture straight ahead in Xiangqi */
-                  if (rf > 0 && !SameColor(board[rf][ff], board[rf - 1][ff]) ) {
-                           callback(board, flags, NormalMove,
-                                    rf, ff, rf - 1, ff, closure);
-                  }
-                  /* and move sideways when across the river */
-                  for (s = -1; s <= 1; s += 2) {
-                      if (rf < BOARD_HEIGHT>>1 &&
-                          ff + s >= BOARD_LEFT && ff + s < BOARD_RGHT &&
-                          !BlackPiece(board[rf][ff+s]) ) {
-                           callback(board, flags, NormalMove,
-                                    rf, ff, rf, ff+s, closure);
-                      }
-                  }
-                  break;
-              }
-	      if (rf > 0 && board[rf - 1][ff] == EmptySquare) {
-		  callback(board, flags,
-			   rf <= promoRank ? BlackPromotion : NormalMove,
-			   rf, ff, rf - 1, ff, closure);
-	      }
-	      if (rf >= (BOARD_HEIGHT+1>>1)+2 && board[rf-1][ff] == EmptySquare && // [HGM] grand
-                  gameInfo.variant != VariantShatranj && /* [HGM] */
-                  gameInfo.variant != VariantCourier  && /* [HGM] */
-		  board[rf-2][ff] == EmptySquare) {
-		  callback(board, flags, NormalMove,
-			   rf, ff, rf-2, ff, closure);
+	      if (mode & M_NULL) {
+		  callback(board, flags, step->kind, rf, ff, rf, ff, closure);
+		  continue;
 	      }
-	      for (s = -1; s <= 1; s += 2) {
-                  if (rf > 0 && ff + s >= BOARD_LEFT && ff + s < BOARD_RGHT &&
-		      ((flags & F_KRIEGSPIEL_CAPTURE) ||
-		       WhitePiece(board[rf - 1][ff + s]))) {
-		      callback(board, flags,
-			       rf <= promoRank ? BlackPromotion : NormalMove,
-			       rf, ff, rf - 1, ff + s, closure);
-		  }
-		  if (rf < BOARD_HEIGHT>>1) {
-                      if (ff + s >= BOARD_LEFT && ff + s < BOARD_RGHT &&
-			  (epfile == ff + s || epfile == EP_UNKNOWN) && rf > 2 &&
-			  board[rf][ff + s] == WhitePawn &&
-			  board[rf-1][ff + s] == EmptySquare) {
-			  callback(board, flags, BlackCapturesEnPassant,
-				   rf, ff, rf-1, ff + s, closure);
+	      hops = 0;
+	      for (i = 1;; i++) {
+		  rt = rf + i * step->dr;
+		  ft = ff + i * step->df;
+                  if (rt < 0 || rt >= height || ft < left || ft >= right) break;
+		  victim = board[rt][ft];
+		  if (mode & M_HOP) { /* Cannon: non-captures up to the screen, capture just behind it */
+		      if (victim == EmptySquare) {
+			  if (!hops) callback(board, flags, step->kind, rf, ff, rt, ft, closure);
+			  continue;
 		      }
+		      if (hops++) {
+			  if (!SameColor(board[rf][ff], victim))
+			      callback(board, flags, step->kind, rf, ff, rt, ft, closure);
+			  break;
+		      }
+		      continue;
 		  }
-	      }
-	      break;
-
-            case WhiteUnicorn:
-            case BlackUnicorn:
-	    case WhiteKnight:
-	    case BlackKnight:
-            mounted:
-	      for (i = -1; i <= 1; i += 2)
-		for (j = -1; j <= 1; j += 2)
-		  for (s = 1; s <= 2; s++) {
-		      rt = rf + i*s;
-		      ft = ff + j*(3-s);
-                      if (!(rt < 0 || rt >= BOARD_HEIGHT || ft < BOARD_LEFT || ft >= BOARD_RGHT)
-                          && ( gameInfo.variant != VariantXiangqi || board[rf+i*(s-1)][ff+j*(2-s)] == EmptySquare)
-                          && !SameColor(board[rf][ff], board[rt][ft]))
-		      callback(board, flags, NormalMove,
-			       rf, ff, rt, ft, closure);
-		  }
-	      break;
-
-            case SHOGI WhiteKnight:
-	      for (s = -1; s <= 1; s += 2) {
-                  if (rf < BOARD_HEIGHT-2 && ff + s >= BOARD_LEFT && ff + s < BOARD_RGHT &&
-                      !SameColor(board[rf][ff], board[rf + 2][ff + s])) {
-                      callback(board, flags, NormalMove,
-                               rf, ff, rf + 2, ff + s, closure);
-		  }
-              }
-	      break;
-
-            case SHOGI BlackKnight:
-	      for (s = -1; s <= 1; s += 2) {
-                  if (rf > 1 && ff + s >= BOARD_LEFT && ff + s < BOARD_RGHT &&
-                      !SameColor(board[rf][ff], board[rf - 2][ff + s])) {
-                      callback(board, flags, NormalMove,
-                               rf, ff, rf - 2, ff + s, closure);
-		  }
-	      }
-	      break;
-
-            case WhiteCannon:
-            case BlackCannon:
-              for (d = 0; d <= 1; d++)
-                for (s = -1; s <= 1; s += 2) {
-                  m = 0;
-		  for (i = 1;; i++) {
-		      rt = rf + (i * s) * d;
-		      ft = ff + (i * s) * (1 - d);
-                      if (rt < 0 || rt >= BOARD_HEIGHT || ft < BOARD_LEFT || ft >= BOARD_RGHT) break;
-                      if (m == 0 && board[rt][ft] == EmptySquare)
-                                 callback(board, flags, NormalMove,
-                                          rf, ff, rt, ft, closure);
-                      if (m == 1 && board[rt][ft] != EmptySquare &&
-                          !SameColor(board[rf][ff], board[rt][ft]) )
-                                 callback(board, flags, NormalMove,
-                                          rf, ff, rt, ft, closure);
-                      if (board[rt][ft] != EmptySquare && m++) break;
-                  }
-                }
-	      break;
-
-            /* Gold General (and all its promoted versions) . First do the */
-            /* diagonal forward steps, then proceed as normal Wazir        */
-            case SHOGI WhiteWazir:
-            case SHOGI (PROMOTED WhitePawn):
-            case SHOGI (PROMOTED WhiteKnight):
-            case SHOGI (PROMOTED WhiteQueen):
-            case SHOGI (PROMOTED WhiteFerz):
-	      for (s = -1; s <= 1; s += 2) {
-                  if (rf < BOARD_HEIGHT-1 && ff + s >= BOARD_LEFT && ff + s < BOARD_RGHT &&
-                      !SameColor(board[rf][ff], board[rf + 1][ff + s])) {
-                      callback(board, flags, NormalMove,
-			       rf, ff, rf + 1, ff + s, closure);
-		  }
-              }
-              goto finishGold;
-
-            case SHOGI BlackWazir:
-            case SHOGI (PROMOTED BlackPawn):
-            case SHOGI (PROMOTED BlackKnight):
-            case SHOGI (PROMOTED BlackQueen):
-            case SHOGI (PROMOTED BlackFerz):
-	      for (s = -1; s <= 1; s += 2) {
-                  if (rf > 0 && ff + s >= BOARD_LEFT && ff + s < BOARD_RGHT &&
-                      !SameColor(board[rf][ff], board[rf - 1][ff + s])) {
-                      callback(board, flags, NormalMove,
-			       rf, ff, rf - 1, ff + s, closure);
-		  }
-	      }
-
-            case WhiteWazir:
-            case BlackWazir:
-            finishGold:
-              for (d = 0; d <= 1; d++)
-                for (s = -1; s <= 1; s += 2) {
-                      rt = rf + s * d;
-                      ft = ff + s * (1 - d);
-                      if (!(rt < 0 || rt >= BOARD_HEIGHT || ft < BOARD_LEFT || ft >= BOARD_RGHT)
-                          && !SameColor(board[rf][ff], board[rt][ft]) &&
-                          (gameInfo.variant != VariantXiangqi || InPalace(rt, ft) ) )
-                               callback(board, flags, NormalMove,
-                                        rf, ff, rt, ft, closure);
-                      }
-	      break;
-
-            case WhiteAlfil:
-            case BlackAlfil:
-                /* [HGM] support Shatranj pieces */
-                for (rs = -1; rs <= 1; rs += 2)
-                  for (fs = -1; fs <= 1; fs += 2) {
-                      rt = rf + 2 * rs;
-                      ft = ff + 2 * fs;
-                      if (!(rt < 0 || rt >= BOARD_HEIGHT || ft < BOARD_LEFT || ft >= BOARD_RGHT)
-                          && ( gameInfo.variant != VariantXiangqi ||
-                               board[rf+rs][ff+fs] == EmptySquare && (2*rf < BOARD_HEIGHT) == (2*rt < BOARD_HEIGHT) )
-
-                          && !SameColor(board[rf][ff], board[rt][ft]))
-                               callback(board, flags, NormalMove,
-                                        rf, ff, rt, ft, closure);
-                      if(gameInfo.variant == VariantShatranj || gameInfo.variant == VariantCourier
-                                                             || gameInfo.variant == VariantXiangqi) continue; // classical Alfil
-                      rt = rf + rs; // in unknown variant we assume Modern Elephant, which can also do one step
-                      ft = ff + fs;
-                      if (!(rt < 0 || rt >= BOARD_HEIGHT || ft < BOARD_LEFT || ft >= BOARD_RGHT)
-                          && !SameColor(board[rf][ff], board[rt][ft]))
-                               callback(board, flags, NormalMove,
-                                        rf, ff, rt, ft, closure);
-		  }
-                if(gameInfo.variant == VariantSpartan)
-                   for(fs = -1; fs <= 1; fs += 2) {
-                      ft = ff + fs;
-                      if (!(ft < BOARD_LEFT || ft >= BOARD_RGHT) && board[rf][ft] == EmptySquare)
-                               callback(board, flags, NormalMove, rf, ff, rf, ft, closure);
-                   }
-                break;
-
-            /* Make Dragon-Horse also do Dababba moves outside Shogi, for better disambiguation in variant Fairy */
-	    case WhiteCardinal:
-	    case BlackCardinal:
-              for (d = 0; d <= 1; d++) // Dababba moves that Rook cannot do
-                for (s = -2; s <= 2; s += 4) {
-		      rt = rf + s * d;
-		      ft = ff + s * (1 - d);
-                      if (rt < 0 || rt >= BOARD_HEIGHT || ft < BOARD_LEFT || ft >= BOARD_RGHT) continue;
-		      if (SameColor(board[rf][ff], board[rt][ft])) continue;
-		      callback(board, flags, NormalMove, rf, ff, rt, ft, closure);
-		  }
-
-            /* Shogi Dragon Horse has to continue with Wazir after Bishop */
-            case SHOGI WhiteCardinal:
-            case SHOGI BlackCardinal:
-              m++;
-
-            /* Capablanca Archbishop continues as Knight                  */
-            case WhiteAngel:
-            case BlackAngel:
-              m++;
-
-            /* Shogi Bishops are ordinary Bishops */
-            case SHOGI WhiteBishop:
-            case SHOGI BlackBishop:
-	    case WhiteBishop:
-	    case BlackBishop:
-	      for (rs = -1; rs <= 1; rs += 2)
-                for (fs = -1; fs <= 1; fs += 2)
-		  for (i = 1;; i++) {
-		      rt = rf + (i * rs);
-		      ft = ff + (i * fs);
-                      if (rt < 0 || rt >= BOARD_HEIGHT || ft < BOARD_LEFT || ft >= BOARD_RGHT) break;
-		      if (SameColor(board[rf][ff], board[rt][ft])) break;
-		      callback(board, flags, NormalMove,
-			       rf, ff, rt, ft, closure);
-		      if (board[rt][ft] != EmptySquare) break;
-		  }
-                if(m==1) goto mounted;
-                if(m==2) goto finishGold;
-                /* Bishop falls through */
-	      break;
-
-            /* Shogi Lance is unlike anything, and asymmetric at that */
-            case SHOGI WhiteQueen:
-              for(i = 1;; i++) {
-                      rt = rf + i;
-                      ft = ff;
-                      if (rt >= BOARD_HEIGHT) break;
-		      if (SameColor(board[rf][ff], board[rt][ft])) break;
-		      callback(board, flags, NormalMove,
-			       rf, ff, rt, ft, closure);
-                      if (board[rt][ft] != EmptySquare) break;
-              }
-              break;
-
-            case SHOGI BlackQueen:
-              for(i = 1;; i++) {
-                      rt = rf - i;
-                      ft = ff;
-                      if (rt < 0) break;
-		      if (SameColor(board[rf][ff], board[rt][ft])) break;
-		      callback(board, flags, NormalMove,
-			       rf, ff, rt, ft, closure);
-                      if (board[rt][ft] != EmptySquare) break;
-              }
-              break;
-
-            /* Make Dragon-King Dababba & Rook-like outside Shogi, for better disambiguation in variant Fairy */
-	    case WhiteDragon:
-	    case BlackDragon:
-              for (d = 0; d <= 1; d++) // Dababba moves that Rook cannot do
-                for (s = -2; s <= 2; s += 4) {
-		      rt = rf + s * d;
-		      ft = ff + s * (1 - d);
-                      if (rt < 0 || rt >= BOARD_HEIGHT || ft < BOARD_LEFT || ft >= BOARD_RGHT || board[rf+rt>>1][ff+ft>>1] == EmptySquare) continue;
-		      if (SameColor(board[rf][ff], board[rt][ft])) continue;
-		      callback(board, flags, NormalMove, rf, ff, rt, ft, closure);
-		  }
-              if(gameInfo.variant == VariantSpartan) rookRange = 2; // in Spartan Chess restrict range to modern Dababba
-              goto doRook;
-
-            /* Shogi Dragon King has to continue as Ferz after Rook moves */
-            case SHOGI WhiteDragon:
-            case SHOGI BlackDragon:
-              m++;
-
-            /* Capablanca Chancellor sets flag to continue as Knight      */
-            case WhiteMarshall:
-            case BlackMarshall:
-              m++;
-              m += (gameInfo.variant == VariantSpartan); // in Spartan Chess Chancellor is used for Dragon King.
-
-            /* Shogi Rooks are ordinary Rooks */
-            case SHOGI WhiteRook:
-            case SHOGI BlackRook:
-	    case WhiteRook:
-	    case BlackRook:
-          doRook:
-              for (d = 0; d <= 1; d++)
-                for (s = -1; s <= 1; s += 2)
-		  for (i = 1;; i++) {
-		      rt = rf + (i * s) * d;
-		      ft = ff + (i * s) * (1 - d);
-                      if (rt < 0 || rt >= BOARD_HEIGHT || ft < BOARD_LEFT || ft >= BOARD_RGHT) break;
-		      if (SameColor(board[rf][ff], board[rt][ft])) break;
-		      callback(board, flags, NormalMove,
-			       rf, ff, rt, ft, closure);
-		      if (board[rt][ft] != EmptySquare || i == rookRange) break;
-		  }
-                if(m==1) goto mounted;
-                if(m==2) goto finishSilver;
-	      break;
-
-	    case WhiteQueen:
-	    case BlackQueen:
-	      for (rs = -1; rs <= 1; rs++)
-		for (fs = -1; fs <= 1; fs++) {
-		    if (rs == 0 && fs == 0) continue;
-		    for (i = 1;; i++) {
-			rt = rf + (i * rs);
-			ft = ff + (i * fs);
-                        if (rt < 0 || rt >= BOARD_HEIGHT || ft < BOARD_LEFT || ft >= BOARD_RGHT) break;
-			if (SameColor(board[rf][ff], board[rt][ft])) break;
-			callback(board, flags, NormalMove,
-				 rf, ff, rt, ft, closure);
-			if (board[rt][ft] != EmptySquare) break;
-		    }
-		}
-	      break;
-
-            /* Shogi Pawn and Silver General: first the Pawn move,    */
-            /* then the General continues like a Ferz                 */
-            case WhiteMan:
-                if(gameInfo.variant != VariantMakruk && gameInfo.variant != VariantASEAN) goto commoner;
-            case SHOGI WhitePawn:
-            case SHOGI WhiteFerz:
-                  if (rf < BOARD_HEIGHT-1 &&
-                           !SameColor(board[rf][ff], board[rf + 1][ff]) )
-                           callback(board, flags, NormalMove,
-                                    rf, ff, rf + 1, ff, closure);
-              if(piece != SHOGI WhitePawn) goto finishSilver;
-              break;
-
-            case BlackMan:
-                if(gameInfo.variant != VariantMakruk && gameInfo.variant != VariantASEAN) goto commoner;
-            case SHOGI BlackPawn:
-            case SHOGI BlackFerz:
-                  if (rf > 0 &&
-                           !SameColor(board[rf][ff], board[rf - 1][ff]) )
-                           callback(board, flags, NormalMove,
-                                    rf, ff, rf - 1, ff, closure);
-              if(piece == SHOGI BlackPawn) break;
-
-            case WhiteFerz:
-            case BlackFerz:
-            finishSilver:
-                /* [HGM] support Shatranj pieces */
-                for (rs = -1; rs <= 1; rs += 2)
-                  for (fs = -1; fs <= 1; fs += 2) {
-                      rt = rf + rs;
-                      ft = ff + fs;
-                      if (rt < 0 || rt >= BOARD_HEIGHT || ft < BOARD_LEFT || ft >= BOARD_RGHT) continue;
-                      if (!SameColor(board[rf][ff], board[rt][ft]) &&
-                          (gameInfo.variant != VariantXiangqi || InPalace(rt, ft) ) )
-                               callback(board, flags, NormalMove,
-                                        rf, ff, rt, ft, closure);
+		  if ((mode & M_LAME) && board[rf + step->br][ff + step->bf] != EmptySquare) break;
+		  if ((mode & M_SCREEN) && board[rf + step->br][ff + step->bf] == EmptySquare) break;
+		  if ((mode & M_RIVER) && (2*rf < height) != (2*rt < height)) break;
+		  if ((mode & M_PALACE) && !InPalace(rt, ft)) break;
+		  if (mode & M_EP) {
+		      if ((epfile != ft && epfile != EP_UNKNOWN) || victim != EmptySquare ||
+			  board[rf][ft] != (board[rf][ff] < BlackPawn ? BlackPawn : WhitePawn)) break;
+		  } else if (mode & M_CAPT) {
+		      if (!((mode & M_KRIEG) && (flags & F_KRIEGSPIEL_CAPTURE)) &&
+			  (victim == EmptySquare || SameColor(board[rf][ff], victim))) break;
+		  } else {
+		      if (SameColor(board[rf][ff], victim)) break;
+		      if ((mode & M_NOCAPT) && victim != EmptySquare) break;
 		  }
-                break;
-
-	    case WhiteSilver:
-	    case BlackSilver:
-		m++; // [HGM] superchess: use for Centaur
-            commoner:
-            case SHOGI WhiteKing:
-            case SHOGI BlackKing:
-	    case WhiteKing:
-	    case BlackKing:
-//            walking:
-	      for (i = -1; i <= 1; i++)
-		for (j = -1; j <= 1; j++) {
-		    if (i == 0 && j == 0) continue;
-		    rt = rf + i;
-		    ft = ff + j;
-                    if (rt < 0 || rt >= BOARD_HEIGHT || ft < BOARD_LEFT || ft >= BOARD_RGHT) continue;
-		    if (SameColor(board[rf][ff], board[rt][ft])) continue;
-		    callback(board, flags, NormalMove,
-			     rf, ff, rt, ft, closure);
-		}
-		if(m==1) goto mounted;
-	      break;
-
-	    case WhiteNightrider:
-	    case BlackNightrider:
-	      for (i = -1; i <= 1; i += 2)
-		for (j = -1; j <= 1; j += 2)
-		  for (s = 1; s <= 2; s++) {  int k;
-                    for(k=1;; k++) {
-		      rt = rf + k*i*s;
-		      ft = ff + k*j*(3-s);
-                      if (rt < 0 || rt >= BOARD_HEIGHT || ft < BOARD_LEFT || ft >= BOARD_RGHT) break;
-		      if (SameColor(board[rf][ff], board[rt][ft])) break;
-		      callback(board, flags, NormalMove,
+		  if (mode & M_PROMO)
+		      callback(board, flags, (white ? height-1-rf : rf) <= step->zone ? step->kind : NormalMove,
 			       rf, ff, rt, ft, closure);
-		      if (board[rt][ft] != EmptySquare) break;
-                    }
-		  }
-	      break;
-
-	    Amazon:
-	      /* First do Bishop,then continue like Chancellor */
-	      for (rs = -1; rs <= 1; rs += 2)
-                for (fs = -1; fs <= 1; fs += 2)
-		  for (i = 1;; i++) {
-		      rt = rf + (i * rs);
-		      ft = ff + (i * fs);
-                      if (rt < 0 || rt >= BOARD_HEIGHT || ft < BOARD_LEFT || ft >= BOARD_RGHT) break;
-		      if (SameColor(board[rf][ff], board[rt][ft])) break;
-		      callback(board, flags, NormalMove,
-			       rf, ff, rt, ft, closure);
-		      if (board[rt][ft] != EmptySquare) break;
-		  }
-	      m++;
-	      goto doRook;
-
-	    // Use Lance as Berolina / Spartan Pawn.
-	    case WhiteLance:
-	      if(gameInfo.variant == VariantSuper) goto Amazon;
-	      if (rf < BOARD_HEIGHT-1 && BlackPiece(board[rf + 1][ff]))
-		  callback(board, flags,
-			   rf >= BOARD_HEIGHT-1-promoRank ? WhitePromotion : NormalMove,
-			   rf, ff, rf + 1, ff, closure);
-	      for (s = -1; s <= 1; s += 2) {
-	          if (rf < BOARD_HEIGHT-1 && ff + s >= BOARD_LEFT && ff + s < BOARD_RGHT && board[rf + 1][ff + s] == EmptySquare)
-		      callback(board, flags,
-			       rf >= BOARD_HEIGHT-1-promoRank ? WhitePromotion : NormalMove,
-			       rf, ff, rf + 1, ff + s, closure);
-	          if (rf == 1 && ff + 2*s >= BOARD_LEFT && ff + 2*s < BOARD_RGHT && board[3][ff + 2*s] == EmptySquare )
-		      callback(board, flags, NormalMove, rf, ff, 3, ff + 2*s, closure);
+		  else callback(board, flags, step->kind, rf, ff, rt, ft, closure);
+		  if (victim != EmptySquare || i >= step->range) break;
 	      }
-	      break;
-
-	    case BlackLance:
-	      if(gameInfo.variant == VariantSuper) goto Amazon;
-	      if (rf > 0 && WhitePiece(board[rf - 1][ff]))
-		  callback(board, flags,
-			   rf <= promoRank ? BlackPromotion : NormalMove,
-			   rf, ff, rf - 1, ff, closure);
-	      for (s = -1; s <= 1; s += 2) {
-	          if (rf > 0 && ff + s >= BOARD_LEFT && ff + s < BOARD_RGHT && board[rf - 1][ff + s] == EmptySquare)
-		      callback(board, flags,
-			       rf <= promoRank ? BlackPromotion : NormalMove,
-			       rf, ff, rf - 1, ff + s, closure);
-	          if (rf == BOARD_HEIGHT-2 && ff + 2*s >= BOARD_LEFT && ff + 2*s < BOARD_RGHT && board[rf-2][ff + 2*s] == EmptySquare )
-		      callback(board, flags, NormalMove, rf, ff, rf-2, ff + 2*s, closure);
-	      }
-            break;
-
-	    case WhiteFalcon: // [HGM] wild: for wildcards, self-capture symbolizes move to anywhere
-	    case BlackFalcon:
-	    case WhiteCobra:
-	    case BlackCobra:
-	      callback(board, flags, NormalMove, rf, ff, rf, ff, closure);
-	      break;
-
 	  }
       }
 }
@@ -726,6 +605,7 @@ GenLegalCallback (Board board, int flags, ChessMove kind, int rf, int ff, int rt
 {
     register GenLegalClosure *cl = (GenLegalClosure *) closure;
 
+    if(genDone) return; // [HGM] speed: caller is no longer interested, so do not waste time on check test
     if(rFilter >= 0 && rFilter != rt || fFilter >= 0 && fFilter != ft) return; // [HGM] speed: ignore moves with wrong to-square
 
     if (!(flags & F_IGNORE_CHECK) ) {
@@ -769,6 +649,83 @@ typedef struct {
     int captures; // [HGM] losers
 } LegalityTestClosure;
 
+/* [HGM] speed: the legal moves of one position (in practice the one the user is looking at) can be
+   cached, after which GenLegal and GenLegalTo replay them from the list when asked for that same
+   position, rather than generating them all over again for every click, drag or legality test. */
+
+#define MAX_CACHED 512
+
+struct {
+    Board board;
+    int key, variant, height, width, flags, inCheck, n;
+    struct {
+	unsigned char rf, ff, rt, ft;
+	ChessMove kind;
+    } move[MAX_CACHED];
+} legalCache = { {{0}}, -1 };
+
+extern void CacheCallback P((Board board, int flags, ChessMove kind,
+			     int rf, int ff, int rt, int ft,
+			     VOIDSTAR closure));
+
+void
+CacheCallback (Board board, int flags, ChessMove kind, int rf, int ff, int rt, int ft, VOIDSTAR closure)
+{
+    int n = legalCache.n++;
+    if(n >= MAX_CACHED) return; // overflow makes cache unusable
+    legalCache.move[n].rf = rf;
+    legalCache.move[n].ff = ff;
+    legalCache.move[n].rt = rt;
+    legalCache.move[n].ft = ft;
+    legalCache.move[n].kind = kind;
+}
+
+static int
+CacheHit (Board board, int flags)
+{
+    return legalCache.key >= 0 && legalCache.n <= MAX_CACHED && !xqCheckers[EP_STATUS] && // [HGM] xq: quasi-legal generation not cached
+	   legalCache.flags == flags && legalCache.variant == gameInfo.variant &&
+	   legalCache.height == BOARD_HEIGHT && legalCache.width == BOARD_WIDTH &&
+	   !memcmp(legalCache.board, board, sizeof(Board));
+}
+
+void
+CacheLegalMoves (Board board, int flags, int key)
+{
+    if(key == legalCache.key && CacheHit(board, flags)) return; // still valid
+    legalCache.key = -1; // GenLegal should not replay while we fill
+    legalCache.n = 0;
+    legalCache.inCheck = GenLegal(board, flags, CacheCallback, NULL, EmptySquare);
+    memcpy(legalCache.board, board, sizeof(Board)); // all of it, as castling rights and e.p. status matter too
+    legalCache.key = key;
+    legalCache.flags = flags;
+    legalCache.variant = gameInfo.variant;
+    legalCache.height = BOARD_HEIGHT;
+    legalCache.width = BOARD_WIDTH;
+}
+
+/* Feed the cached moves to the callback, applying the same filtering as the generator would.
+   Castlings are not filtered in GenLegal, and can only occur in GenLegalTo when it falls back on it. */
+static void
+ReplayLegal (Board board, int flags, MoveCallback callback, VOIDSTAR closure, ChessSquare filter, int castle)
+{
+    int i;
+
+    for(i=0; i<legalCache.n && !genDone; i++) {
+	int rf = legalCache.move[i].rf, ff = legalCache.move[i].ff, rt = legalCache.move[i].rt, ft = legalCache.move[i].ft;
+	ChessMove kind = legalCache.move[i].kind;
+	if(kind >= WhiteKingSideCastle && kind <= BlackASideCastleFR) {
+	    if(!castle) continue;
+	} else {
+	    ChessSquare piece = board[rf][ff];
+	    if(PieceToChar(piece) == '~') piece = (ChessSquare) ( DEMOTED piece );
+	    if(filter != EmptySquare && piece != filter) continue;
+	    if((rFilter >= 0 && rFilter != rt) || (fFilter >= 0 && fFilter != ft)) continue;
+	}
+	callback(board, flags, kind, rf, ff, rt, ft, closure);
+    }
+}
+
 
 /* Like GenPseudoLegal, but (1) include castling moves, (2) unless
    F_IGNORE_CHECK is set in the flags, omit moves that would leave the
@@ -784,15 +741,21 @@ GenLegal (Board board, int  flags, MoveCallback callback, VOIDSTAR closure, Ches
     int ff, ft, k, left, right, swap;
     int ignoreCheck = (flags & F_IGNORE_CHECK) != 0;
     ChessSquare wKing = WhiteKing, bKing = BlackKing, *castlingRights = board[CASTLING];
-    int inCheck = !ignoreCheck && CheckTest(board, flags, -1, -1, -1, -1, FALSE); // kludge alert: this would mark pre-existing checkers if status==1
+    int inCheck;
 
+    if(filter == EmptySquare) rFilter = fFilter = -1; // [HGM] speed: do not filter on square if we do not filter on piece
+    if(CacheHit(board, flags)) {
+	ReplayLegal(board, flags, callback, closure, filter, TRUE);
+	return legalCache.inCheck;
+    }
+    inCheck = !ignoreCheck && CheckTest(board, flags, -1, -1, -1, -1, FALSE); // kludge alert: this would mark pre-existing checkers if status==1
     cl.cb = callback;
     cl.cl = closure;
     xqCheckers[EP_STATUS] *= 2; // quasi: if previous CheckTest has been marking, we now set flag for suspending same checkers
-    if(filter == EmptySquare) rFilter = fFilter = -1; // [HGM] speed: do not filter on square if we do not filter on piece
     GenPseudoLegal(board, flags, GenLegalCallback, (VOIDSTAR) &cl, filter);
 
     if (inCheck) return TRUE;
+    if (genDone) return FALSE; // [HGM] speed: callback already found what it needed
 
     /* Generate castling moves */
     if(gameInfo.variant == VariantKnightmate) { /* [HGM] Knightmate */
@@ -951,6 +914,35 @@ GenLegal (Board board, int  flags, MoveCallback callback, VOIDSTAR closure, Ches
 }
 
 
+/* [HGM] speed: like GenLegal, but only for moves of the given piece type to (rt, ft) (-1 = any).
+   Castlings can only come from Kings (or, in S-Chess, Rooks), and need castling rights, so in all
+   other cases we can skip the whole-position in-check test and castling generation, and only test
+   check on the few moves that actually reach the to-square. This makes disambiguation cheap.
+   Without piece filter, or when captures are mandatory, all moves are needed, though. */
+void
+GenLegalTo (Board board, int flags, int rt, int ft, MoveCallback callback, VOIDSTAR closure, ChessSquare filter)
+{
+    GenLegalClosure cl;
+    int i, type = (int)filter < (int)BlackPawn ? (int)filter : BLACK_TO_WHITE filter, rights = 0;
+
+    for(i=0; i<6; i++) rights |= board[CASTLING][i] != NoRights;
+    rFilter = rt; fFilter = ft;
+    if(xqCheckers[EP_STATUS] == 1 || // [HGM] xq: GenLegal must mark the checkers that were already there
+       filter == EmptySquare || (flags & F_MANDATORY_CAPTURE) || // [HGM] losers: must see captures to all squares
+       (rights && (type == WhiteKing || type == WhiteUnicorn || (type == WhiteRook && gameInfo.variant == VariantSChess)))) {
+	GenLegal(board, flags, callback, closure, filter);
+	return;
+    }
+    if(CacheHit(board, flags)) {
+	ReplayLegal(board, flags, callback, closure, filter, FALSE);
+	return;
+    }
+    cl.cb = callback;
+    cl.cl = closure;
+    GenPseudoLegal(board, flags, GenLegalCallback, (VOIDSTAR) &cl, filter);
+}
+
+
 typedef struct {
     int rking, fking;
     int check;
@@ -1114,12 +1106,12 @@ LegalityTest (Board board, int flags, int rf, int ff, int rt, int ft, int promoC
 
     cl.rf = rf;
     cl.ff = ff;
-    cl.rt = rFilter = rt; // [HGM] speed: filter on to-square
-    cl.ft = fFilter = ft;
+    cl.rt = rt;
+    cl.ft = ft;
     cl.kind = IllegalMove;
     cl.captures = 0; // [HGM] losers: prepare to count legal captures.
     if(flags & F_MANDATORY_CAPTURE) filterPiece = EmptySquare; // [HGM] speed: do not filter in suicide, to find all captures
-    GenLegal(board, flags, LegalityTestCallback, (VOIDSTAR) &cl, filterPiece);
+    GenLegalTo(board, flags, rt, ft, LegalityTestCallback, (VOIDSTAR) &cl, filterPiece); // [HGM] speed: filter on to-square
     if((flags & F_MANDATORY_CAPTURE) && cl.captures && board[rt][ft] == EmptySquare
 		&& cl.kind != WhiteCapturesEnPassant && cl.kind != BlackCapturesEnPassant)
 	return(IllegalMove); // [HGM] losers: if there are legal captures, non-capts are illegal
@@ -1211,6 +1203,53 @@ MateTestCallback (Board board, int flags, ChessMove kind, int rf, int ff, int rt
     register MateTestClosure *cl = (MateTestClosure *) closure;
 
     cl->count++;
+    genDone = TRUE; // [HGM] speed: one legal move is enough to know we are not mated
+}
+
+typedef struct {
+    int rking, fking;
+    char (*blocks)[BOARD_FILES];
+} InterposeClosure;
+
+extern void InterposeCallback P((Board board, int flags, ChessMove kind,
+				 int rf, int ff, int rt, int ft,
+				 VOIDSTAR closure));
+
+void
+InterposeCallback (Board board, int flags, ChessMove kind, int rf, int ff, int rt, int ft, VOIDSTAR closure)
+{   // for marking the squares between a checker and the King, where a drop could block the check
+    register InterposeClosure *cl = (InterposeClosure *) closure;
+    int dr = rt - rf, df = ft - ff, n, i;
+
+    if (rt != cl->rking || ft != cl->fking) return;
+    n = dr > 0 ? dr : -dr; i = df > 0 ? df : -df;
+    if (dr && df && n != i) return; // not on a line (e.g. Knight): such checks cannot be blocked
+    if (i > n) n = i;
+    dr /= n; df /= n;
+    for (i = 1; i < n; i++) cl->blocks[rf + i*dr][ff + i*df] = TRUE;
+}
+
+/* Mark the empty squares where a drop could possibly resolve the check; returns their number */
+static int
+Interpositions (Board board, int flags, char blocks[BOARD_RANKS][BOARD_FILES])
+{
+    InterposeClosure cl;
+    ChessSquare king = flags & F_WHITE_ON_MOVE ? WhiteKing : BlackKing;
+    int r, f, n = 0;
+
+    if(gameInfo.variant == VariantKnightmate)
+        king = flags & F_WHITE_ON_MOVE ? WhiteUnicorn : BlackUnicorn;
+    for (r = 0; r < BOARD_RANKS; r++) for (f = 0; f < BOARD_FILES; f++) blocks[r][f] = FALSE;
+    cl.blocks = blocks;
+    for (cl.fking = BOARD_LEFT+0; cl.fking < BOARD_RGHT; cl.fking++) // same King as CheckTest would find
+	for (cl.rking = 0; cl.rking < BOARD_HEIGHT; cl.rking++)
+	    if (board[cl.rking][cl.fking] == king) goto found;
+    return -1; // no King; anything goes
+  found:
+    GenPseudoLegal(board, flags ^ F_WHITE_ON_MOVE, InterposeCallback, (VOIDSTAR) &cl, EmptySquare);
+    for (r = 0; r < BOARD_HEIGHT; r++) for (f = BOARD_LEFT; f < BOARD_RGHT; f++)
+	n += blocks[r][f] = blocks[r][f] && board[r][f] == EmptySquare;
+    return n;
 }
 
 /* Return MT_NONE, MT_CHECK, MT_CHECKMATE, or MT_STALEMATE */
@@ -1242,7 +1281,9 @@ MateTest (Board board, int flags)
 		if(myPieces == 1) return MT_BARE;
     }
     cl.count = 0;
+    genDone = FALSE; // [HGM] speed: MateTestCallback aborts generation at the first legal move
     inCheck = GenLegal(board, flags, MateTestCallback, (VOIDSTAR) &cl, EmptySquare);
+    genDone = FALSE;
     // [HGM] 3check: yet to do!
     if (cl.count > 0) {
 	return inCheck ? MT_CHECK : MT_NONE;
@@ -1250,10 +1291,13 @@ MateTest (Board board, int flags)
         if(gameInfo.holdingsWidth && gameInfo.variant != VariantSuper && gameInfo.variant != VariantGreat
                                  && gameInfo.variant != VariantSChess && gameInfo.variant != VariantGrand) { // drop game
             int r, f, n, holdings = flags & F_WHITE_ON_MOVE ? BOARD_WIDTH-1 : 0;
-            for(r=0; r<BOARD_HEIGHT; r++) for(f=BOARD_LEFT; f<BOARD_RGHT; f++) if(board[r][f] == EmptySquare) // all empty squares
+            char blocks[BOARD_RANKS][BOARD_FILES];
+            // [HGM] speed: when in check, only drops between King and checker can help, otherwise drops cannot expose the King
+            int dropFlags = inCheck ? flags : flags | F_IGNORE_CHECK, all = !inCheck || Interpositions(board, flags, blocks) < 0;
+            for(r=0; r<BOARD_HEIGHT; r++) for(f=BOARD_LEFT; f<BOARD_RGHT; f++) if(board[r][f] == EmptySquare && (all || blocks[r][f]))
                 for(n=0; n<BOARD_HEIGHT; n++) // all pieces in hand
                     if(board[n][holdings] != EmptySquare) {
-                        int moveType = LegalDrop(board, flags, board[n][holdings], r, f);
+                        int moveType = LegalDrop(board, dropFlags, board[n][holdings], r, f);
                         if(moveType == WhiteDrop || moveType == BlackDrop) return (inCheck ? MT_CHECK : MT_NONE); // we have legal drop
                     }
         }
@@ -1269,6 +1313,25 @@ MateTest (Board board, int flags)
     }
 }
 
+/* [HGM] speed: MateTest only as far as needed for the '+' or '#' suffix of a SAN move. If the side
+   to move is not in check, there is nothing to mark, and no moves need to be generated at all.
+   Only in variants where being stalemated loses (which we mark '#') do we need the full test. */
+int
+CheckMateTest (Board board, int flags)
+{
+    switch(gameInfo.variant) {
+      case VariantXiangqi:
+      case VariantShatranj:
+      case VariantShogi:
+      case VariantSuicide:
+	return MateTest(board, flags);
+      default:
+	break;
+    }
+    if((flags & F_IGNORE_CHECK) || !CheckTest(board, flags, -1, -1, -1, -1, FALSE)) return MT_NONE;
+    return MateTest(board, flags);
+}
+
 
 extern void DisambiguateCallback P((Board board, int flags, ChessMove kind,
 				    int rf, int ff, int rt, int ft,
@@ -1317,22 +1380,21 @@ Disambiguate (Board board, int flags, DisambiguateClosure *closure)
     closure->count = closure->captures = 0;
     closure->rf = closure->ff = closure->rt = closure->ft = 0;
     closure->kind = ImpossibleMove;
-    rFilter = closure->rtIn; // [HGM] speed: only consider moves to given to-square
-    fFilter = closure->ftIn;
+    // [HGM] speed: only consider moves of pieces of requested type to given to-square
     if(quickFlag) { // [HGM] speed: try without check test first, because if that is not ambiguous, we are happy
-        GenLegal(board, flags|F_IGNORE_CHECK, DisambiguateCallback, (VOIDSTAR) closure, closure->pieceIn);
+        GenLegalTo(board, flags|F_IGNORE_CHECK, closure->rtIn, closure->ftIn, DisambiguateCallback, (VOIDSTAR) closure, closure->pieceIn);
         if(closure->count > 1) { // gamble did not pay off. retry with check test to resolve ambiguity
             closure->count = closure->captures = 0;
             closure->rf = closure->ff = closure->rt = closure->ft = 0;
             closure->kind = ImpossibleMove;
-            GenLegal(board, flags, DisambiguateCallback, (VOIDSTAR) closure, closure->pieceIn); // [HGM] speed: only pieces of requested type
+            GenLegalTo(board, flags, closure->rtIn, closure->ftIn, DisambiguateCallback, (VOIDSTAR) closure, closure->pieceIn);
         }
     } else
-    GenLegal(board, flags, DisambiguateCallback, (VOIDSTAR) closure, closure->pieceIn); // [HGM] speed: only pieces of requested type
+    GenLegalTo(board, flags, closure->rtIn, closure->ftIn, DisambiguateCallback, (VOIDSTAR) closure, closure->pieceIn);
     if (closure->count == 0) {
 	/* See if it's an illegal move due to check */
         illegal = 1;
-        GenLegal(board, flags|F_IGNORE_CHECK, DisambiguateCallback, (VOIDSTAR) closure, closure->pieceIn);
+        GenLegalTo(board, flags|F_IGNORE_CHECK, closure->rtIn, closure->ftIn, DisambiguateCallback, (VOIDSTAR) closure, closure->pieceIn);
 	if (closure->count == 0) {
 	    /* No, it's not even that */
 	  if(!appData.testLegality && closure->pieceIn != EmptySquare) {
@@ -1581,19 +1643,20 @@ CoordsToAlgebraic (Board board, int flags, int rf, int ff, int rt, int ft, int p
 	/* Piece move */
 	cl.rf = rf;
 	cl.ff = ff;
-	cl.rt = rFilter = rt; // [HGM] speed: filter on to-square
-	cl.ft = fFilter = ft;
+	cl.rt = rt;
+	cl.ft = ft;
 	cl.piece = piece;
 	cl.kind = IllegalMove;
 	cl.rank = cl.file = cl.either = 0;
         c = PieceToChar(piece) ;
-        GenLegal(board, flags, CoordsToAlgebraicCallback, (VOIDSTAR) &cl, c!='~' ? piece : (DEMOTED piece)); // [HGM] speed
+        // [HGM] speed: only the other pieces of this type that can reach the to-square matter
+        GenLegalTo(board, flags, rt, ft, CoordsToAlgebraicCallback, (VOIDSTAR) &cl, c!='~' ? piece : (DEMOTED piece));
 
 	if (cl.kind == IllegalMove && !(flags&F_IGNORE_CHECK)) {
 	    /* Generate pretty moves for moving into check, but
 	       still return IllegalMove.
 	    */
-            GenLegal(board, flags|F_IGNORE_CHECK, CoordsToAlgebraicCallback, (VOIDSTAR) &cl, c!='~' ? piece : (DEMOTED piece));
+            GenLegalTo(board, flags|F_IGNORE_CHECK, rt, ft, CoordsToAlgebraicCallback, (VOIDSTAR) &cl, c!='~' ? piece : (DEMOTED piece));
 	    if (cl.kind == IllegalMove) break;
 	    cl.kind = IllegalMove;
 	}
@@ -1769,6 +1832,67 @@ ProtectedCallback (Board board, int flags, ChessMove kind, int rf, int ff, int r
 	fprintf(debugFP, "try %c%c%c%c=%d\n", ff+AAA, rf+ONE,ft+AAA, rt+ONE, cl->recaptures);
 }
 
+// [HGM] speed: attack maps, i.e. the legal captures of one side in a position, as PerpetualChase needs them.
+// A repetition cycle visits the same positions over and over, and is judged again after every move of it,
+// so we keep the maps of recent positions around, rather than generating all moves again for each use.
+
+#define MAX_MAPS 64
+
+typedef struct {
+    Board board;
+    int variant, flags, quasi, n;
+    struct {
+	unsigned char rf, ff, rt, ft;
+    } capt[100];
+} AttackMap;
+
+AttackMap attackMaps[MAX_MAPS];
+int nrOfMaps, mapStore;
+
+extern void AttackMapCallback P((Board board, int flags, ChessMove kind,
+				 int rf, int ff, int rt, int ft,
+				 VOIDSTAR closure));
+
+void
+AttackMapCallback (Board board, int flags, ChessMove kind, int rf, int ff, int rt, int ft, VOIDSTAR closure)
+{
+    register AttackMap *map = (AttackMap *) closure;
+
+    if(board[rt][ft] == EmptySquare || map->n >= 100) return; // only captures
+    map->capt[map->n].rf = rf;
+    map->capt[map->n].ff = ff;
+    map->capt[map->n].rt = rt;
+    map->capt[map->n].ft = ft;
+    map->n++;
+}
+
+/* Get the legal captures in the position for the side indicated by flags. With quasi set, checks that
+   already existed in the position are ignored (so we also see the captures by pinned pieces etc.) */
+AttackMap *
+GetAttackMap (Board board, int flags, int quasi)
+{
+    int i;
+    AttackMap *map;
+
+    for(i=0; i<nrOfMaps; i++) {
+	map = &attackMaps[i];
+	if(map->flags == flags && map->quasi == quasi && map->variant == gameInfo.variant && CompareBoards(map->board, board))
+	    return map;
+    }
+    map = &attackMaps[mapStore]; // not cached; replace oldest
+    if(++mapStore >= MAX_MAPS) mapStore = 0;
+    if(nrOfMaps < MAX_MAPS) nrOfMaps++;
+    CopyBoard(map->board, board);
+    map->variant = gameInfo.variant;
+    map->flags = flags;
+    map->quasi = quasi;
+    map->n = 0;
+    if(quasi) { CopyBoard(xqCheckers, nullBoard); xqCheckers[EP_STATUS] = 1; } // giant kludge to make GenLegal ignore pre-existing checks
+    GenLegal(board, flags, AttackMapCallback, (VOIDSTAR) map, EmptySquare);
+    xqCheckers[EP_STATUS] = 0; // disable the generation of quasi-legal moves again
+    return map;
+}
+
 extern char moveList[MAX_MOVES][MOVE_LEN];
 
 int
@@ -1777,13 +1901,16 @@ PerpetualChase (int first, int last)
     int i, j, k, tail;
     ChaseClosure cl;
     ChessSquare captured;
+    AttackMap *map;
 
     preyStackPointer = 0;        // clear stack of chased pieces
     for(i=first; i<last; i+=2) { // for all positions with same side to move
         if(appData.debugMode) fprintf(debugFP, "judge position %i\n", i);
 	chaseStackPointer = 0;   // clear stack that is going to hold possible chases
 	// determine all captures possible after the move, and put them on chaseStack
-	GenLegal(boards[i+1], PosFlags(i), AttacksCallback, &cl, EmptySquare);
+	map = GetAttackMap(boards[i+1], PosFlags(i), FALSE);
+	for(j=0; j<map->n; j++)
+	    AttacksCallback(boards[i+1], PosFlags(i), NormalMove, map->capt[j].rf, map->capt[j].ff, map->capt[j].rt, map->capt[j].ft, &cl);
 	if(appData.debugMode) { int n;
 	    for(n=0; n<chaseStackPointer; n++)
                 fprintf(debugFP, "%c%c%c%c ", chaseStack[n].ff+AAA, chaseStack[n].rf+ONE,
@@ -1795,9 +1922,9 @@ PerpetualChase (int first, int last)
 	cl.ff = moveList[i][0]-AAA+BOARD_LEFT;
 	cl.rt = moveList[i][3]-ONE;
 	cl.ft = moveList[i][2]-AAA+BOARD_LEFT;
-	CopyBoard(xqCheckers, nullBoard); xqCheckers[EP_STATUS] = 1; // giant kludge to make GenLegal ignore pre-existing checks
-	GenLegal(boards[i],   PosFlags(i), ExistingAttacksCallback, &cl, EmptySquare);
-	xqCheckers[EP_STATUS] = 0; // disable the generation of quasi-legal moves again
+	map = GetAttackMap(boards[i], PosFlags(i), TRUE);
+	for(j=0; j<map->n; j++)
+	    ExistingAttacksCallback(boards[i], PosFlags(i), NormalMove, map->capt[j].rf, map->capt[j].ff, map->capt[j].rt, map->capt[j].ft, &cl);
 	if(appData.debugMode) { int n;
 	    for(n=0; n<chaseStackPointer; n++)
                 fprintf(debugFP, "%c%c%c%c ", chaseStack[n].ff+AAA, chaseStack[n].rf+ONE,
@@ -96,6 +96,12 @@ typedef void (*MoveCallback) P((Board board, int flags, ChessMove kind,
 #define EP_CHECKMATE 100       /* [HGM] verify: record mates in epStatus for easy claim verification    */
 #define EP_STALEMATE -16
 
+/* Compile the moves of all piece types in the current variant into
+   the tables GenPseudoLegal uses.  Must be called when the variant or
+   board size changes (GenPseudoLegal does it itself as a fallback).
+*/
+extern void InitMoveTables P((void));
+
 /* Call callback once for each pseudo-legal move in the given
    position, except castling moves.  A move is pseudo-legal if it is
    legal, or if it would be legal except that it leaves the king in
@@ -116,6 +122,22 @@ extern void GenPseudoLegal P((Board board, int flags,
 extern int GenLegal P((Board board, int flags,
 			MoveCallback callback, VOIDSTAR closure, ChessSquare filter));
 
+/* Like GenLegal, but only for moves of pieces of type filter to the
+   square (rt, ft); rt or ft can be -1 for any rank or file.  Unless
+   the piece could be involved in castling, this skips the test whether
+   the player on move is in check and the castling generation, so that
+   only moves that actually reach the given square are tested for check.
+*/
+extern void GenLegalTo P((Board board, int flags, int rt, int ft,
+			  MoveCallback callback, VOIDSTAR closure, ChessSquare filter));
+
+/* Generate the legal moves of the given position once, and remember
+   them under the given key (e.g. the move number), so that GenLegal
+   and GenLegalTo can replay them while that position is queried again.
+   Returns immediately if the position cached under key is unchanged.
+*/
+extern void CacheLegalMoves P((Board board, int flags, int key));
+
 /* If the player on move were to move from (rf, ff) to (rt, ft), would
    he leave himself in check?  Or if rf == -1, is the player on move
    in check now?  enPassant must be TRUE if the indicated move is an
@@ -147,6 +169,11 @@ extern ChessMove LegalityTest P((Board board, int flags,
 /* Return MT_NONE, MT_CHECK, MT_CHECKMATE, or MT_STALEMATE */
 extern int MateTest P((Board board, int flags));
 
+/* Like MateTest, but only reliable for MT_CHECK, MT_CHECKMATE and
+   MT_STAINMATE, i.e. what is needed to append '+' or '#' to a move in
+   SAN.  Does not generate any moves when the player on move is not in check. */
+extern int CheckMateTest P((Board board, int flags));
+
 typedef struct {
     /* Input data */
     ChessSquare pieceIn;        /* EmptySquare if unknown */
@@ -0,0 +1,685 @@
+/*
+ * xboard.c -- display-less front end for XBoard, to run engine matches and tourneys
+ *
+ * Copyright 2013 Free Software Foundation, Inc.
+ * ------------------------------------------------------------------------
+ *
+ * GNU XBoard is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * GNU XBoard is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.  *
+ *
+ *------------------------------------------------------------------------
+ ** See the file ChangeLog for a revision history.  */
+
+// [HGM] nogui: this front-end has no windows at all, so it needs neither an X display nor a toolkit.
+// Engine I/O and timers run in the epoll loop of uevents.c, and everything the back-end would display
+// is dropped here, except error messages, which go to stderr. It is meant for running matches and
+// tourneys (-mm, -tf) on machines without display; everything that needs user interaction is absent.
+
+#include "config.h"
+
+#include <stdio.h>
+#include <ctype.h>
+#include <signal.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if STDC_HEADERS
+# include <stdlib.h>
+# include <string.h>
+#else /* not STDC_HEADERS */
+extern char *getenv();
+# if HAVE_STRING_H
+#  include <string.h>
+# else /* not HAVE_STRING_H */
+#  include <strings.h>
+# endif /* not HAVE_STRING_H */
+#endif /* not STDC_HEADERS */
+
+#if TIME_WITH_SYS_TIME
+# include <sys/time.h>
+# include <time.h>
+#else
+# if HAVE_SYS_TIME_H
+#  include <sys/time.h>
+# else
+#  include <time.h>
+# endif
+#endif
+
+#if HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+
+#if ENABLE_NLS
+#include <locale.h>
+#endif
+
+#include "common.h"
+
+#include "frontend.h"
+#include "backend.h"
+#include "backendz.h"
+#include "moves.h"
+#include "xboard.h"
+#include "xboard2.h"
+#include "childio.h"
+#include "menus.h"
+#include "board.h"
+#include "dialogs.h"
+#include "engineoutput.h"
+#include "usystem.h"
+#include "uevents.h"
+#include "gettext.h"
+#include "draw.h"
+
+#ifdef ENABLE_NLS
+# define  _(s) gettext (s)
+# define N_(s) gettext_noop (s)
+#else
+# define  _(s) (s)
+# define N_(s)  s
+#endif
+
+int main P((int argc, char **argv));
+RETSIGTYPE IntSigHandler P((int sig));
+
+char *layoutName = "normalLayout";
+char installDir[] = "."; // [HGM] UCI: needed for UCI; probably needs run-time initializtion
+
+int smallLayout = 0, tinyLayout = 0,
+  fromX = -1, fromY = -1, toX, toY, commentUp = False,
+  errorExitStatus = -1, defaultLineGap;
+char *chessDir, *programName, *programVersion;
+char *icsTextMenuString;
+char *icsNames;
+char *firstChessProgramNames;
+char *secondChessProgramNames;
+Option *currBoard;
+int dialogError;
+
+typedef unsigned int BoardSize;
+BoardSize boardSize;
+Boolean chessProgram;
+Boolean alwaysOnTop = False;
+int minX, minY;
+
+static int running; // start-up is done, so fatal errors must make us exit
+
+WindowPlacement wpMain;
+WindowPlacement wpConsole;
+WindowPlacement wpComment;
+WindowPlacement wpMoveHistory;
+WindowPlacement wpEvalGraph;
+WindowPlacement wpEngineOutput;
+WindowPlacement wpGameList;
+WindowPlacement wpTags;
+WindowPlacement wpDualBoard;
+
+//---------------------------------------------------------------------------------------------------------
+// some symbol definitions to provide the proper (= XBoard) context for the code in args.h
+#define XBOARD True
+#define JAWS_ARGS
+#define CW_USEDEFAULT (1<<31)
+#define ICS_TEXT_MENU_SIZE 90
+#define DEBUG_FILE "xboard.debug"
+#define SetCurrentDirectory chdir
+#define GetCurrentDirectory(SIZE, NAME) getcwd(NAME, SIZE)
+#define OPTCHAR "-"
+#define SEPCHAR " "
+
+// The option definition and parsing code common to XBoard and WinBoard is collected in this file
+#include "args.h"
+
+// front-end part of option handling; the display options are only kept, to be saved unchanged
+
+char *crWhite = "#FFFFB0"; // normally defined in draw.c, which we do not have
+char *crBlack = "#AD5D3D";
+
+void *
+colorVariable[] = {
+  &appData.whitePieceColor,
+  &appData.blackPieceColor,
+  &appData.lightSquareColor,
+  &appData.darkSquareColor,
+  &appData.highlightSquareColor,
+  &appData.premoveHighlightColor,
+  &appData.lowTimeWarningColor,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  &crWhite,
+  &crBlack,
+  NULL
+};
+
+#define MAX_SIZE 130
+Boolean fontValid[NUM_FONTS][MAX_SIZE];
+char *fontTable[NUM_FONTS][MAX_SIZE];
+
+void
+ParseFont (char *name, int number)
+{
+  int size;
+  if(sscanf(name, "size%d:", &size)) {
+    if(size >= 0 && size<MAX_SIZE) {
+	fontTable[number][size] = strdup(strchr(name, ':')+1);
+	fontValid[number][size] = True;
+    }
+    return;
+  }
+  switch(number) {
+    case 0: // CLOCK_FONT
+	appData.clockFont = strdup(name);
+      break;
+    case 1: // MESSAGE_FONT
+	appData.font = strdup(name);
+      break;
+    case 2: // COORD_FONT
+	appData.coordFont = strdup(name);
+      break;
+    default:
+      return;
+  }
+}
+
+void
+SetFontDefaults ()
+{
+  appData.clockFont = CLOCK_FONT_NAME;
+  appData.coordFont = COORD_FONT_NAME;
+  appData.font  =   DEFAULT_FONT_NAME;
+}
+
+void
+CreateFonts ()
+{
+}
+
+void
+ParseColor (int n, char *name)
+{
+  if(colorVariable[n]) *(char**)colorVariable[n] = strdup(name);
+}
+
+void
+ParseTextAttribs (ColorClass cc, char *s)
+{
+    (&appData.colorShout)[cc] = strdup(s);
+}
+
+void
+ParseBoardSize (void *addr, char *name)
+{
+    appData.boardSize = strdup(name);
+}
+
+void
+LoadAllSounds ()
+{
+}
+
+void
+SetCommPortDefaults ()
+{
+}
+
+void
+SaveFontArg (FILE *f, ArgDescriptor *ad)
+{   // only the fonts from the settings file are known, so write those back
+  int i, n = (int)(intptr_t)ad->argLoc;
+  if(n > 2) return;
+  for(i=0; i<MAX_SIZE; i++) if(fontValid[n][i])
+    fprintf(f, OPTCHAR "%s" SEPCHAR "\"size%d:%s\"\n", ad->argName, i, fontTable[n][i]);
+}
+
+void
+ExportSounds ()
+{
+}
+
+void
+SaveAttribsArg (FILE *f, ArgDescriptor *ad)
+{
+	fprintf(f, OPTCHAR "%s" SEPCHAR "%s\n", ad->argName, (&appData.colorShout)[(int)(intptr_t)ad->argLoc]);
+}
+
+void
+SaveColor (FILE *f, ArgDescriptor *ad)
+{
+	if(colorVariable[(int)(intptr_t)ad->argLoc])
+	fprintf(f, OPTCHAR "%s" SEPCHAR "%s\n", ad->argName, *(char**)colorVariable[(int)(intptr_t)ad->argLoc]);
+}
+
+void
+SaveBoardSize (FILE *f, char *name, void *addr)
+{
+  fprintf(f, OPTCHAR "%s" SEPCHAR "%s\n", name, appData.boardSize);
+}
+
+void
+ParseCommPortSettings (char *s)
+{
+}
+
+void
+GetWindowCoords ()
+{   // there are no windows, so the placement read from the settings file is saved unchanged
+}
+
+void
+PrintCommPortSettings (FILE *f, char *name)
+{
+}
+
+void
+EnsureOnScreen (int *x, int *y, int minX, int minY)
+{
+}
+
+int
+MainWindowUp ()
+{   // [HGM] nogui: stands for 'start-up is done' here, as DisplayFatalError then has to terminate us
+  return running;
+}
+
+void
+PopUpStartupDialog ()
+{
+}
+
+char *
+ConvertToLine (int argc, char **argv)
+{
+  static char line[128*1024], buf[1024];
+  int i;
+
+  line[0] = NULLCHAR;
+  for(i=1; i<argc; i++)
+    {
+      if( (strchr(argv[i], ' ') || strchr(argv[i], '\n') ||strchr(argv[i], '\t') || argv[i][0] == NULLCHAR)
+	  && argv[i][0] != '{' )
+	snprintf(buf, sizeof(buf)/sizeof(buf[0]), "{%s} ", argv[i]);
+      else
+	snprintf(buf, sizeof(buf)/sizeof(buf[0]), "%s ", argv[i]);
+      strncat(line, buf, 128*1024 - strlen(line) - 1 );
+    }
+
+  line[strlen(line)-1] = NULLCHAR;
+  return line;
+}
+
+//--------------------------------------------------------------------------------------------
+
+int
+main (int argc, char **argv)
+{
+    int i;
+    char *p;
+
+    srandom(time(0)); // [HGM] book: make random truly random
+
+    setbuf(stdout, NULL);
+    setbuf(stderr, NULL);
+    debugFP = stderr;
+
+    if(argc > 1 && (!strcmp(argv[1], "-v" ) || !strcmp(argv[1], "--version" ))) {
+	printf("%s version %s\n", PACKAGE_NAME, PACKAGE_VERSION);
+	exit(0);
+    }
+
+    programName = strrchr(argv[0], '/');
+    if (programName == NULL)
+      programName = argv[0];
+    else
+      programName++;
+
+#ifdef ENABLE_NLS
+    bindtextdomain(PACKAGE, LOCALEDIR);
+    bind_textdomain_codeset(PACKAGE, "UTF-8");
+    textdomain(PACKAGE);
+#endif
+
+    appData.boardSize = "";
+    InitAppData(ConvertToLine(argc, argv));
+    appData.noGUI = TRUE;             // [HGM] nogui: the back-end then skips most display updates itself
+    appData.popupExitMessage = FALSE; // and nobody could press OK on that
+    if(!UEventsInit()) {
+	fprintf(stderr, _("%s: this system does not support the event loop needed without display\n"), programName);
+	exit(1);
+    }
+
+    p = getenv("HOME");
+    if (p == NULL) p = "/tmp";
+    i = strlen(p) + strlen("/.xboardXXXXXx.pgn") + 1;
+    gameCopyFilename = (char*) malloc(i);
+    gamePasteFilename = (char*) malloc(i);
+    snprintf(gameCopyFilename,i, "%s/.xboard%05uc.pgn", p, getpid());
+    snprintf(gamePasteFilename,i, "%s/.xboard%05up.pgn", p, getpid());
+
+    { // [HGM] initstring: kludge to fix bad bug. expand '\n' characters in init string and computer string.
+	static char buf[MSG_SIZ];
+	EscapeExpand(buf, appData.firstInitString);
+	appData.firstInitString = strdup(buf);
+	EscapeExpand(buf, appData.secondInitString);
+	appData.secondInitString = strdup(buf);
+	EscapeExpand(buf, appData.firstComputerString);
+	appData.firstComputerString = strdup(buf);
+	EscapeExpand(buf, appData.secondComputerString);
+	appData.secondComputerString = strdup(buf);
+    }
+
+    if ((chessDir = (char *) getenv("CHESSDIR")) == NULL) {
+	chessDir = ".";
+    } else {
+	if (chdir(chessDir) != 0) {
+	    fprintf(stderr, _("%s: can't cd to CHESSDIR: "), programName);
+	    perror(chessDir);
+	    exit(1);
+	}
+    }
+
+    if (appData.debugMode && appData.nameOfDebugFile && strcmp(appData.nameOfDebugFile, "stderr")) {
+        if ((debugFP = fopen(appData.nameOfDebugFile, "w")) == NULL)  {
+           printf(_("Failed to open file '%s'\n"), appData.nameOfDebugFile);
+           exit(errno);
+        }
+        setbuf(debugFP, NULL);
+    }
+
+    if(appData.NrFiles > BOARD_FILES ||
+       appData.NrRanks > BOARD_RANKS   )
+	 DisplayFatalError(_("Recompile with larger BOARD_RANKS or BOARD_FILES to support this size"), 0, 2);
+
+    InitBackEnd1();
+
+    gameInfo.variant = StringToVariant(appData.variant);
+    InitPosition(FALSE);
+
+    InitBackEnd2();
+
+    if (errorExitStatus != -1) exit(errorExitStatus); // DisplayFatalError during start-up only printed the message
+
+    signal(SIGINT, IntSigHandler);
+    signal(SIGTERM, IntSigHandler);
+
+    gameInfo.boardWidth = 0;
+    InitPosition(TRUE);
+
+    running = TRUE;
+    UEventLoop(NULL);
+
+    if (appData.debugMode) fclose(debugFP); // [DM] debug
+    return 0;
+}
+
+RETSIGTYPE
+IntSigHandler (int sig)
+{
+    ExitEvent(sig);
+}
+
+void
+CmailSigHandlerCallBack (InputSourceRef isr, VOIDSTAR closure, char *message, int count, int error)
+{
+    ReloadCmailMsgEvent(TRUE);	/* Reload cmail msg  */
+}
+
+//------------------------------------- input sources and timers ---------------------------------
+
+#define INPUT_SOURCE_BUF_SIZE 8192
+
+typedef struct {
+    CPKind kind;
+    int fd;
+    int lineByLine;
+    LineBuffer lines;
+    InputCallback func;
+    int tag;
+    char buf[INPUT_SOURCE_BUF_SIZE];
+    VOIDSTAR closure;
+} InputSource;
+
+static void
+DoInputCallback (VOIDSTAR data)
+{
+    InputSource *is = (InputSource *) data;
+    int count;
+
+    if (is->lineByLine) {
+	ReadLines(is, is->fd, &is->lines, is->func, is->closure);
+    } else {
+	count = read(is->fd, is->buf, INPUT_SOURCE_BUF_SIZE);
+	(is->func)(is, is->closure, is->buf, count, count == -1 ? errno : 0);
+    }
+}
+
+InputSourceRef
+AddInputSource (ProcRef pr, int lineByLine, InputCallback func, VOIDSTAR closure)
+{
+    InputSource *is;
+    ChildProc *cp = (ChildProc *) pr;
+
+    is = (InputSource *) calloc(1, sizeof(InputSource));
+    is->lineByLine = lineByLine;
+    is->func = func;
+    is->closure = closure;
+    if (pr == NoProc) {
+	is->kind = CPReal;
+	is->fd = fileno(stdin);
+    } else {
+	is->kind = cp->kind;
+	is->fd = cp->fdFrom;
+    }
+    is->tag = UAddWatch(is->fd, DoInputCallback, is);
+    return (InputSourceRef) is;
+}
+
+void
+RemoveInputSource (InputSourceRef isr)
+{
+    InputSource *is = (InputSource *) isr;
+
+    if (is->tag == 0) return;
+    URemoveWatch(is->tag);
+    is->tag = 0;
+}
+
+static int delayedEventTimerTag, loadGameTimerTag, analysisClockTag, clockTimerTag;
+static DelayedEventCallback delayedEventCallback;
+
+static void
+FireDelayedEvent (VOIDSTAR data)
+{
+    URemoveTimeout(delayedEventTimerTag);
+    delayedEventTimerTag = 0;
+    delayedEventCallback();
+}
+
+void
+ScheduleDelayedEvent (DelayedEventCallback cb, long millisec)
+{
+    if(delayedEventTimerTag && delayedEventCallback == cb)
+	// [HGM] alive: replace, rather than add or flush identical event
+	URemoveTimeout(delayedEventTimerTag);
+    delayedEventCallback = cb;
+    delayedEventTimerTag = UAddTimeout(millisec, FALSE, FireDelayedEvent, NULL);
+}
+
+DelayedEventCallback
+GetDelayedEvent ()
+{
+    return delayedEventTimerTag ? delayedEventCallback : NULL;
+}
+
+void
+CancelDelayedEvent ()
+{
+    if (delayedEventTimerTag) {
+	URemoveTimeout(delayedEventTimerTag);
+	delayedEventTimerTag = 0;
+    }
+}
+
+int
+StopLoadGameTimer ()
+{
+    if (loadGameTimerTag == 0) return FALSE;
+    URemoveTimeout(loadGameTimerTag);
+    loadGameTimerTag = 0;
+    return TRUE;
+}
+
+static void
+LoadGameTimerCallback (VOIDSTAR data)
+{
+    URemoveTimeout(loadGameTimerTag);
+    loadGameTimerTag = 0;
+    AutoPlayGameLoop();
+}
+
+void
+StartLoadGameTimer (long millisec)
+{
+    loadGameTimerTag = UAddTimeout(millisec, FALSE, LoadGameTimerCallback, NULL);
+}
+
+static void
+AnalysisClockCallback (VOIDSTAR data)
+{
+    if (gameMode == AnalyzeMode || gameMode == AnalyzeFile
+         || appData.icsEngineAnalyze) { // [DM]
+	AnalysisPeriodicEvent(0);
+    }
+}
+
+void
+StartAnalysisClock ()
+{
+    analysisClockTag = UAddTimeout(2000, TRUE, AnalysisClockCallback, NULL);
+}
+
+int
+StopClockTimer ()
+{
+    if (clockTimerTag == 0) return FALSE;
+    URemoveTimeout(clockTimerTag);
+    clockTimerTag = 0;
+    return TRUE;
+}
+
+static void
+ClockTimerCallback (VOIDSTAR data)
+{
+    URemoveTimeout(clockTimerTag);
+    clockTimerTag = 0;
+    DecrementClocks();
+}
+
+void
+StartClockTimer (long millisec)
+{
+    clockTimerTag = UAddTimeout(millisec, FALSE, ClockTimerCallback, NULL);
+}
+
+//------------------------------- what the other front-ends display -------------------------------
+// [HGM] nogui: the back-end calls these for windows, menus and drawing; without display they have nothing to do
+
+int
+GenericPopUp (Option *option, char *title, DialogClass dlgNr, DialogClass parent, int modal, int topLevel)
+{   // only error messages are reported; DisplayError already printed them in match mode
+    if((dlgNr == ErrorDlg || dlgNr == FatalDlg) && !appData.matchMode && !appData.debugMode && option->name)
+	fprintf(stderr, "%s: %s: %s\n", programName, title, option->name);
+    return 0;
+}
+
+int  PopDown (DialogClass n) { return 0; }
+int  DialogExists (DialogClass n) { return FALSE; }
+void AddHandler (Option *opt, DialogClass dlg, int nr) { }
+int  AppendText (Option *opt, char *s) { return 0; }
+void CursorAtEnd (Option *opt) { }
+void FocusOnWidget (Option *opt, DialogClass dlg) { }
+void GetWidgetState (Option *opt, int *state) { *state = 0; }
+void GetWidgetText (Option *opt, char **buf) { *buf = ""; }
+void GraphExpose (Option *opt, int x, int y, int w, int h) { }
+void HardSetFocus (Option *opt) { }
+void HighlightListBoxItem (Option *opt, int index) { }
+void HighlightText (Option *opt, int from, int to, Boolean highlight) { }
+void HighlightWithScroll (Option *opt, int index, int max) { }
+void LoadListBox (Option *opt, char *emptyText, int n1, int n2) { }
+void MarkMenuItem (char *menuRef, int state) { }
+void ScrollToCursor (Option *opt, int caretPos) { }
+int  SelectedListBoxItem (Option *opt) { return -1; }
+void SendText (int n) { }
+void SetColor (char *colorName, Option *box) { }
+void SetDialogTitle (DialogClass dlg, char *title) { }
+void SetIconName (DialogClass dlg, char *name) { }
+void SetInsertPos (Option *opt, int pos) { }
+void SetWidgetLabel (Option *opt, char *buf) { }
+void SetWidgetState (Option *opt, int state) { }
+void SetWidgetText (Option *opt, char *buf, int n) { }
+int  ShiftKeys () { return 0; }
+void UnCaret () { }
+
+void BoardToTop () { }
+void CopySomething (char *src) { }
+void DisplayIcsInteractionTitle (String message) { }
+void DisplayTimerLabel (Option *opt, char *color, long timer, int highlight) { }
+void EnableButtonBar (int state) { }
+void EnableNamedMenuItem (char *menuRef, int state) { }
+void FileNamePopUpWrapper (char *label, char *def, char *filter, FileProc proc, Boolean pathFlag,
+			   char *openMode, char **name, FILE **fp) { }
+void FlashDelay (int flash_delay) { }
+void FrameDelay (int time) { }
+void FreezeUI () { }
+void ThawUI () { }
+void ManProc () { }
+void ModeHighlight () { }
+void PasteGameProc () { }
+void PastePositionProc () { }
+void SetClockIcon (int color) { }
+void SetMenuEnables (Enables *enab) { }
+void SetWindowTitle (char *text, char *title, char *icon) { }
+void SetupDropMenu () { }
+void SlaveResize (Option *opt) { }
+void UpdateLogos (int displ) { }
+
+void DrawWidgetIcon (Option *opt, int nIcon) { }
+void InitEngineOutput (Option *opt, Option *memo2) { }
+void InsertIntoMemo (int which, char * text, int where) { }
+void ResizeWindowControls (int mode) { }
+
+void CopyRectangle (AnimNr anr, int srcBuf, int destBuf, int srcX, int srcY, int width, int height, int destX, int destY) { }
+void CreateAnimVars () { }
+void DrawBlank (AnimNr anr, int x, int y, int startColor) { }
+void DrawBorder (int x, int y, int type, int odd) { }
+void DrawDot (int marker, int x, int y, int r) { }
+void DrawEvalText (char *buf, int cbBuf, int y) { }
+void DrawGrid () { }
+void DrawLogo (Option *opt, void *logo) { }
+void DrawOneSquare (int x, int y, ChessSquare piece, int square_color, int marker, char *tString, char *bString, int align) { }
+void DrawPolygon (Pnt arrow[], int nr) { }
+void DrawRectangle (int left, int top, int right, int bottom, int side, int style) { }
+void DrawSeekAxis (int x, int y, int xTo, int yTo) { }
+void DrawSeekBackground (int left, int top, int right, int bottom) { }
+void DrawSeekDot (int x, int y, int colorNr) { }
+void DrawSeekText (char *buf, int x, int y) { }
+void DrawSegment (int x, int y, int *lastX, int *lastY, int penType) { }
+void InitDrawingHandle (Option *opt) { }
+void InitDrawingParams (int reloadPieces) { }
+void InitDrawingSizes (int boardSize, int flags) { }
+void InsertPiece (AnimNr anr, ChessSquare piece) { }
+void SetDragPiece (AnimNr anr, ChessSquare piece) { }
+void SwitchWindow (int main) { }
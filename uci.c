@@ -30,13 +30,14 @@
 #include <string.h>
 
 #include "common.h"
+#include "frontend.h"
 #include "backend.h"
 Boolean GetArgValue(char *a);
 
 void
 InitEngineUCI (const char *iniDir, ChessProgramState *cps)
 {   // replace engine command line by adapter command with expanded meta-symbols
-    if( cps->isUCI ) {
+    if( cps->isUCI && !(cps->isUCI == 1 && appData.nativeUCI) ) { // [HGM] uci: plain UCI is handled internally
         char *p, *q;
         char polyglotCommand[MSG_SIZ];
 
@@ -71,3 +72,297 @@ InitEngineUCI (const char *iniDir, ChessProgramState *cps)
         cps->dir = appData.polyglotDir;
     }
 }
+
+/*
+ * [HGM] uci: built-in translation between the CECP commands the back-end sends and the UCI protocol,
+ * so that UCI engines can be run without an adapter process. Only normal Chess is supported this way;
+ * UCCI and USI engines, and UCI engines when -nativeUCI is off, still go through the adapter.
+ */
+
+typedef struct {
+    int ready;                 // received uciok
+    int force, analyze, post;
+    int searching, ignore;     // a search is running / nr of bestmoves still to be ignored
+    int st, sd, mps, inc;      // time control: secs per move, depth, moves per session, increment (msec)
+    long base, myTime, oppTime;
+    int pings[64], nPings;     // ping numbers waiting for readyok
+    int hash, threads, syzygy; // engine has these options
+    char name[MSG_SIZ];
+    char *features;            // option features collected before uciok
+    int featLen;
+    char fen[MSG_SIZ];         // position set by setboard ("" = start position)
+    int nMoves, moveStart[MAX_MOVES];
+    char moves[MAX_MOVES*8];   // game moves, space separated, in UCI notation
+} UCIState;
+
+static void
+ToEngine (ChessProgramState *cps, char *s, int *err)
+{
+    if(appData.debugMode) fprintf(debugFP, "  %-6s< %s", cps->which, s);
+    if(OutputToProcess(cps->pr, s, strlen(s), err) < (int)strlen(s) && !*err) *err = -1;
+}
+
+static void
+ToBackEnd (ChessProgramState *cps, char *s)
+{   // present translated engine output to the back-end as if the engine had said it
+    char buf[MSG_SIZ*4];
+    if(appData.debugMode) fprintf(debugFP, "  %-6s> %s\n", cps->which, s);
+    safeStrCpy(buf, s, sizeof(buf));
+    HandleMachineMove(buf, cps);
+}
+
+void
+UCIStart (ChessProgramState *cps)
+{   // set up (or drop) translation for a freshly started engine
+    UCIState *u = (UCIState *) cps->uci;
+    if(cps->isUCI != 1 || !appData.nativeUCI) {
+	if(u) free(u->features), free(u);
+	cps->uci = NULL;
+	return;
+    }
+    if(u == NULL) u = (UCIState *) calloc(1, sizeof(UCIState));
+    else free(u->features), memset(u, 0, sizeof(UCIState));
+    cps->uci = (void *) u;
+}
+
+static int
+WhiteToMove (UCIState *u)
+{
+    char *p = strchr(u->fen, ' ');
+    return (p && p[1] == 'b') == (u->nMoves & 1);
+}
+
+static void
+StopSearch (ChessProgramState *cps, int *err)
+{   // abort a running search, and prepare to ignore its result
+    UCIState *u = (UCIState *) cps->uci;
+    if(!u->searching) return;
+    ToEngine(cps, "stop\n", err);
+    u->ignore++; u->searching = FALSE;
+}
+
+static void
+StartSearch (ChessProgramState *cps, int *err)
+{
+    UCIState *u = (UCIState *) cps->uci;
+    char buf[MAX_MOVES*8 + 2*MSG_SIZ];
+    int white = WhiteToMove(u);
+
+    snprintf(buf, sizeof(buf), "position %s%s%s%s\n", *u->fen ? "fen " : "startpos", u->fen,
+	     u->nMoves ? " moves " : "", u->moves);
+    ToEngine(cps, buf, err);
+    if(u->analyze) safeStrCpy(buf, "go infinite", MSG_SIZ); else
+    if(u->st) snprintf(buf, MSG_SIZ, "go movetime %d", 1000*u->st); else {
+	snprintf(buf, MSG_SIZ, "go wtime %ld btime %ld", 10*(white ? u->myTime : u->oppTime), 10*(white ? u->oppTime : u->myTime));
+	if(u->inc) snprintf(buf + strlen(buf), MSG_SIZ, " winc %d binc %d", u->inc, u->inc);
+	if(u->mps) snprintf(buf + strlen(buf), MSG_SIZ, " movestogo %d", u->mps - (u->nMoves/2) % u->mps);
+    }
+    if(u->sd && !u->analyze) snprintf(buf + strlen(buf), MSG_SIZ, " depth %d", u->sd);
+    strcat(buf, "\n");
+    ToEngine(cps, buf, err);
+    u->searching = TRUE;
+}
+
+static void
+AddMove (UCIState *u, char *move)
+{
+    int len = strlen(u->moves);
+    if(u->nMoves >= MAX_MOVES-1) return;
+    if(!strcmp(move, "@@@@")) move = "0000"; // null move
+    u->moveStart[u->nMoves++] = len;
+    snprintf(u->moves + len, sizeof(u->moves) - len, "%s%s", len ? " " : "", move);
+}
+
+static void
+TakeBack (UCIState *u, int n)
+{
+    while(n-- > 0 && u->nMoves > 0) u->moves[u->moveStart[--u->nMoves]] = NULLCHAR;
+}
+
+int
+UCIToEngine (ChessProgramState *cps, char *message, int *outError)
+{   // translate CECP command(s) to UCI, and send them; returns nr of characters 'sent' (as OutputToProcess)
+    UCIState *u = (UCIState *) cps->uci;
+    char line[MSG_SIZ], buf[2*MSG_SIZ], *p = message, *q, arg[MSG_SIZ];
+    int n, err = 0, len = strlen(message);
+
+    while(*p) {
+	q = strchr(p, '\n'); n = (q ? q - p : strlen(p));
+	if(n >= MSG_SIZ) n = MSG_SIZ - 1;
+	strncpy(line, p, n); line[n] = NULLCHAR;
+	p += n + (q != NULL);
+	arg[0] = NULLCHAR; sscanf(line, "%*s %[^\n]", arg);
+
+	if(!strcmp(line, "xboard")) ToEngine(cps, "uci\n", &err); else
+	if(!strcmp(line, "new")) {
+	    StopSearch(cps, &err);
+	    u->fen[0] = u->moves[0] = NULLCHAR; u->nMoves = 0;
+	    u->force = u->analyze = FALSE; u->sd = u->st = 0;
+	    ToEngine(cps, "ucinewgame\n", &err);
+	} else
+	if(!strcmp(line, "force")) StopSearch(cps, &err), u->force = TRUE; else
+	if(!strcmp(line, "go")) { u->force = FALSE; if(!u->searching) StartSearch(cps, &err); } else
+	if(!strncmp(line, "usermove ", 9)) {
+	    int restart = u->analyze || u->searching;
+	    StopSearch(cps, &err);
+	    AddMove(u, arg);
+	    if(restart || !u->force) StartSearch(cps, &err);
+	} else
+	if(!strncmp(line, "setboard ", 9)) {
+	    StopSearch(cps, &err);
+	    safeStrCpy(u->fen, arg, MSG_SIZ); u->moves[0] = NULLCHAR; u->nMoves = 0;
+	    if(u->analyze) StartSearch(cps, &err);
+	} else
+	if(!strcmp(line, "undo") || !strcmp(line, "remove")) {
+	    StopSearch(cps, &err);
+	    TakeBack(u, line[0] == 'u' ? 1 : 2);
+	    if(u->analyze) StartSearch(cps, &err);
+	} else
+	if(!strncmp(line, "time ", 5)) u->myTime = atol(arg); else
+	if(!strncmp(line, "otim ", 5)) u->oppTime = atol(arg); else
+	if(!strncmp(line, "level ", 6)) {
+	    int min = 0, sec = 0; float inc = 0;
+	    if(sscanf(arg, "%d %d:%d %f", &u->mps, &min, &sec, &inc) != 4) sscanf(arg, "%d %d %f", &u->mps, &min, &inc), sec = 0;
+	    u->base = 60*min + sec; u->inc = 1000*inc + 0.5; u->st = 0;
+	} else
+	if(!strncmp(line, "st ", 3)) u->st = atoi(arg); else
+	if(!strncmp(line, "sd ", 3)) u->sd = atoi(arg); else
+	if(!strcmp(line, "post")) u->post = TRUE; else
+	if(!strcmp(line, "nopost")) u->post = FALSE; else
+	if(!strncmp(line, "ping ", 5)) {
+	    if(u->nPings < 64) u->pings[u->nPings++] = atoi(arg);
+	    ToEngine(cps, "isready\n", &err);
+	} else
+	if(!strcmp(line, "?")) { if(u->searching && !u->analyze) ToEngine(cps, "stop\n", &err); } else
+	if(!strcmp(line, "analyze")) { StopSearch(cps, &err); u->analyze = TRUE; StartSearch(cps, &err); } else
+	if(!strcmp(line, "exit")) { StopSearch(cps, &err); u->analyze = FALSE; } else
+	if(!strncmp(line, "result", 6)) StopSearch(cps, &err); else
+	if(!strcmp(line, "quit")) StopSearch(cps, &err), ToEngine(cps, "quit\n", &err); else
+	if(!strncmp(line, "memory ", 7) && u->hash) {
+	    snprintf(buf, sizeof(buf), "setoption name Hash value %s\n", arg); ToEngine(cps, buf, &err);
+	} else
+	if(!strncmp(line, "cores ", 6) && u->threads) {
+	    snprintf(buf, sizeof(buf), "setoption name Threads value %s\n", arg); ToEngine(cps, buf, &err);
+	} else
+	if(!strncmp(line, "egtpath syzygy ", 15) && u->syzygy) {
+	    snprintf(buf, sizeof(buf), "setoption name SyzygyPath value %s\n", line + 15); ToEngine(cps, buf, &err);
+	} else
+	if(!strncmp(line, "option ", 7)) {
+	    if((q = strchr(arg, '=')) != NULL) *q++ = NULLCHAR;
+	    if(q) snprintf(buf, sizeof(buf), "setoption name %s value %s\n", arg, q);
+	    else  snprintf(buf, sizeof(buf), "setoption name %s\n", arg); // button
+	    ToEngine(cps, buf, &err);
+	}
+	// all other commands (accepted, rejected, protover, random, hard, easy, computer, name, ...) have no UCI equivalent
+    }
+    *outError = err;
+    return err ? 0 : len;
+}
+
+static char *
+Keyword (char *line, char *key)
+{   // find word in UCI line, and return pointer to what follows it
+    int n = strlen(key);
+    char *p = line;
+    while((p = strstr(p, key)) != NULL) {
+	if((p == line || p[-1] == ' ') && (p[n] == ' ' || p[n] == NULLCHAR)) return p + n + (p[n] == ' ');
+	p += n;
+    }
+    return NULL;
+}
+
+static void
+AddOption (ChessProgramState *cps, char *line)
+{   // convert UCI option definition to CECP option feature
+    UCIState *u = (UCIState *) cps->uci;
+    char name[MSG_SIZ], type[MSG_SIZ], def[MSG_SIZ], buf[4*MSG_SIZ], *p, *q;
+    int min = 0, max = 0;
+
+    if(!(p = Keyword(line, "name")) || !(q = Keyword(p, "type"))) return;
+    snprintf(name, MSG_SIZ, "%.*s", (int)(q - p - 6), p);
+    sscanf(q, "%s", type);
+    def[0] = NULLCHAR;
+    if((p = Keyword(q, "default")) != NULL) {
+	for(q = p; *q && strncmp(q, " min ", 5) && strncmp(q, " max ", 5) && strncmp(q, " var ", 5); q++);
+	snprintf(def, MSG_SIZ, "%.*s", (int)(q - p), p);
+	if(!strcmp(def, "<empty>")) def[0] = NULLCHAR;
+    }
+    if((p = Keyword(line, "min")) != NULL) min = atoi(p);
+    if((p = Keyword(line, "max")) != NULL) max = atoi(p);
+
+    if(!strcmp(name, "Hash")) { u->hash = TRUE; return; }      // these are set through CECP commands
+    if(!strcmp(name, "Threads")) { u->threads = TRUE; return; }
+    if(!strcmp(name, "SyzygyPath")) { u->syzygy = TRUE; return; }
+    if(!strcmp(name, "Ponder") || !strncmp(name, "UCI_", 4)) return;
+
+    if(!strcmp(type, "spin"))   snprintf(buf, sizeof(buf), " option=\"%s -spin %d %d %d\"", name, atoi(def), min, max); else
+    if(!strcmp(type, "check"))  snprintf(buf, sizeof(buf), " option=\"%s -check %d\"", name, !strcmp(def, "true")); else
+    if(!strcmp(type, "string")) snprintf(buf, sizeof(buf), " option=\"%s -string %s\"", name, def); else
+    if(!strcmp(type, "button")) snprintf(buf, sizeof(buf), " option=\"%s -button\"", name); else
+    if(!strcmp(type, "combo")) {
+	int len = snprintf(buf, sizeof(buf), " option=\"%s -combo ", name), first = TRUE;
+	for(p = line; (p = Keyword(p, "var")) != NULL; first = FALSE) {
+	    for(q = p; *q && strncmp(q, " var ", 5); q++);
+	    len += snprintf(buf + len, sizeof(buf) - len, "%s%s%.*s", first ? "" : " /// ",
+			    strncmp(p, def, q - p) || def[q - p] ? "" : "*", (int)(q - p), p);
+	    if(len >= (int)sizeof(buf)) return;
+	    p = q;
+	}
+	snprintf(buf + len, sizeof(buf) - len, "\"");
+    } else return;
+    u->features = realloc(u->features, u->featLen + strlen(buf) + 1);
+    strcpy(u->features + u->featLen, buf); u->featLen += strlen(buf);
+}
+
+void
+UCIFromEngine (ChessProgramState *cps, char *line)
+{   // translate a line of UCI engine output, and pass the result to the back-end
+    UCIState *u = (UCIState *) cps->uci;
+    char buf[MAX_MOVES*8 + MSG_SIZ], move[MOVE_LEN], *p;
+    int n;
+
+    if(!strncmp(line, "info ", 5)) {
+	long long nodes = 0; int depth = 0, score = 0, time = 0;
+	if(!(u->post || u->analyze) || u->ignore || !(p = Keyword(line, "pv"))) {
+	    if((p = Keyword(line, "string")) != NULL) snprintf(buf, MSG_SIZ, "# %s", p), ToBackEnd(cps, buf);
+	    return;
+	}
+	if((p = Keyword(line, "depth")) != NULL) depth = atoi(p);
+	if((p = Keyword(line, "time")) != NULL) time = atoi(p);
+	if((p = Keyword(line, "nodes")) != NULL) sscanf(p, "%lld", &nodes);
+	if((p = Keyword(line, "score")) != NULL) {
+	    if(!strncmp(p, "cp ", 3)) score = atoi(p+3);
+	    else if(!strncmp(p, "mate ", 5)) n = atoi(p+5), score = (n > 0 ? 100000 - n : -100000 - n);
+	}
+	snprintf(buf, sizeof(buf), "%d %d %d %lld %s", depth, score, time/10, nodes, Keyword(line, "pv"));
+	ToBackEnd(cps, buf);
+    } else
+    if(!strncmp(line, "bestmove", 8)) {
+	if(u->ignore) { u->ignore--; return; } // search was aborted
+	u->searching = FALSE;
+	if(u->analyze || sscanf(line + 8, "%31s", move) != 1 || !strcmp(move, "(none)") || !strcmp(move, "0000")) return;
+	AddMove(u, move);
+	snprintf(buf, MSG_SIZ, "move %s", move);
+	ToBackEnd(cps, buf);
+    } else
+    if(!strcmp(line, "readyok")) {
+	if(u->nPings == 0) return;
+	snprintf(buf, MSG_SIZ, "pong %d", u->pings[0]);
+	memmove(u->pings, u->pings + 1, --u->nPings * sizeof(int));
+	ToBackEnd(cps, buf);
+    } else
+    if(!strncmp(line, "id name ", 8)) safeStrCpy(u->name, line + 8, MSG_SIZ); else
+    if(!strncmp(line, "option ", 7)) AddOption(cps, line); else
+    if(!strcmp(line, "uciok") && !u->ready) {
+	u->ready = TRUE;
+	snprintf(buf, sizeof(buf), "feature ping=1 setboard=1 usermove=1 time=1 draw=0 sigint=0 sigterm=0 reuse=1 analyze=1"
+		 " colors=0 name=0 nps=0 debug=1 memory=%d smp=%d%s variants=\"normal\" myname=\"%s\"",
+		 u->hash, u->threads, u->syzygy ? " egt=\"syzygy\"" : "", *u->name ? u->name : "UCI engine");
+	ToBackEnd(cps, buf);
+	if(u->features) { // options as separate command, as they might be long
+	    snprintf(buf, sizeof(buf), "feature%s", u->features);
+	    ToBackEnd(cps, buf);
+	}
+	ToBackEnd(cps, "feature done=1");
+    }
+}
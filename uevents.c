@@ -0,0 +1,185 @@
+/*
+ * uevents.c -- toolkit-independent event loop for the display-less XBoard
+ *
+ * Copyright 2013 Free Software Foundation, Inc.
+ * ------------------------------------------------------------------------
+ *
+ * GNU XBoard is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * GNU XBoard is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.  *
+ *
+ *------------------------------------------------------------------------
+ ** See the file ChangeLog for a revision history.  */
+
+// [HGM] epoll: the display-less front-end (nogui/xboard.c) has no toolkit main loop, so it runs
+// engine I/O and timers in this epoll loop, where timers are timerfds, so they fire at the requested
+// time on the monotonic clock, and every wakeup is one system call.
+
+#include "config.h"
+
+#include <stdio.h>
+#include <errno.h>
+
+#if STDC_HEADERS
+# include <stdlib.h>
+# include <string.h>
+#endif /* STDC_HEADERS */
+
+#if HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+
+#if HAVE_SYS_EPOLL_H && HAVE_SYS_TIMERFD_H
+# include <sys/epoll.h>
+# include <sys/timerfd.h>
+# define EPOLL_LOOP
+#endif
+
+#include "common.h"
+#include "uevents.h"
+
+#ifdef EPOLL_LOOP
+
+#define MAX_EVENTS 256
+
+typedef struct {
+    int fd;        // the watched file, or our timerfd
+    int timer;     // slot is timer (timerfds are kept for re-use when it is freed)
+    int used;
+    int serial;    // to recognize events for a slot that was freed and re-used in the same batch
+    EventCallback cb;
+    VOIDSTAR data;
+} UEvent;
+
+static UEvent slot[MAX_EVENTS];
+static int epfd = -1, serial;
+
+int
+UEventsInit ()
+{
+    if(epfd < 0) epfd = epoll_create1(EPOLL_CLOEXEC);
+    return epfd >= 0;
+}
+
+int
+UEventsActive ()
+{
+    return epfd >= 0;
+}
+
+static int
+Register (int n, int fd)
+{
+    struct epoll_event ev;
+
+    slot[n].used = TRUE;
+    slot[n].serial = ++serial;
+    ev.events = EPOLLIN;
+    ev.data.u64 = (unsigned long long) slot[n].serial << 32 | n;
+    if(epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0 && // recycled timerfds are still in the set
+       (errno != EEXIST || epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev) < 0)) {
+	slot[n].used = FALSE;
+	return 0;
+    }
+    return n + 1; // tags are never 0, as callers use that for 'none'
+}
+
+int
+UAddWatch (int fd, EventCallback cb, VOIDSTAR data)
+{
+    int n;
+
+    for(n=0; n<MAX_EVENTS; n++) if(!slot[n].used && !slot[n].timer) break;
+    if(n >= MAX_EVENTS) return 0;
+    slot[n].fd = fd;
+    slot[n].cb = cb;
+    slot[n].data = data;
+    return Register(n, fd);
+}
+
+void
+URemoveWatch (int tag)
+{
+    UEvent *ev = slot + tag - 1;
+
+    if(tag <= 0 || !ev->used) return;
+    epoll_ctl(epfd, EPOLL_CTL_DEL, ev->fd, NULL);
+    ev->used = FALSE;
+}
+
+int
+UAddTimeout (long millisec, int repeat, EventCallback cb, VOIDSTAR data)
+{
+    struct itimerspec t;
+    int n;
+
+    for(n=0; n<MAX_EVENTS; n++) if(!slot[n].used && slot[n].timer) break; // try to recycle a timerfd
+    if(n >= MAX_EVENTS) {
+	for(n=0; n<MAX_EVENTS; n++) if(!slot[n].used && !slot[n].timer) break;
+	if(n >= MAX_EVENTS) return 0;
+	if((slot[n].fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) < 0) return 0;
+	slot[n].timer = TRUE;
+    }
+    if(millisec <= 0) millisec = 1; // zero would disarm
+    t.it_value.tv_sec = millisec / 1000;
+    t.it_value.tv_nsec = (millisec % 1000) * 1000000;
+    t.it_interval = repeat ? t.it_value : (struct timespec) { 0, 0 };
+    timerfd_settime(slot[n].fd, 0, &t, NULL);
+    slot[n].cb = cb;
+    slot[n].data = data;
+    return Register(n, slot[n].fd);
+}
+
+void
+URemoveTimeout (int tag)
+{
+    static struct itimerspec off;
+    UEvent *ev = slot + tag - 1;
+
+    if(tag <= 0 || !ev->used) return;
+    timerfd_settime(ev->fd, 0, &off, NULL); // disarm, and keep it in the epoll set for next use
+    ev->used = FALSE;
+}
+
+void
+UEventLoop (void (*idle)(void))
+{
+    struct epoll_event ev[64];
+    int i, n;
+
+    while(1) {
+	n = epoll_wait(epfd, ev, 64, -1);
+	if(n < 0 && errno != EINTR) break;
+	for(i=0; i<n; i++) {
+	    int k = ev[i].data.u64 & 0xFFFFFFFF, s = ev[i].data.u64 >> 32;
+	    if(!slot[k].used || slot[k].serial != s) continue; // removed by an earlier callback of this batch
+	    if(slot[k].timer) {
+		unsigned long long expirations;
+		if(read(slot[k].fd, &expirations, sizeof(expirations)) < 0) continue; // disarmed in the meantime
+	    }
+	    slot[k].cb(slot[k].data);
+	}
+	if(idle) idle();
+    }
+}
+
+#else
+
+int UEventsInit () { return FALSE; }
+int UEventsActive () { return FALSE; }
+int UAddWatch (int fd, EventCallback cb, VOIDSTAR data) { return 0; }
+void URemoveWatch (int tag) { }
+int UAddTimeout (long millisec, int repeat, EventCallback cb, VOIDSTAR data) { return 0; }
+void URemoveTimeout (int tag) { }
+void UEventLoop (void (*idle)(void)) { }
+
+#endif
@@ -0,0 +1,38 @@
+/*
+ * uevents.h -- toolkit-independent event loop for the display-less XBoard
+ *
+ * Copyright 2013 Free Software Foundation, Inc.
+ * ------------------------------------------------------------------------
+ *
+ * GNU XBoard is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * GNU XBoard is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/.  *
+ *
+ *------------------------------------------------------------------------
+ ** See the file ChangeLog for a revision history.  */
+
+typedef void (*EventCallback) P((VOIDSTAR data));
+
+/* Switch to the epoll loop; returns FALSE if not available on this system */
+int UEventsInit P((void));
+int UEventsActive P((void));
+
+/* Call cb whenever fd is readable; returns tag for removal */
+int UAddWatch P((int fd, EventCallback cb, VOIDSTAR data));
+void URemoveWatch P((int tag));
+
+/* Call cb after millisec (and every millisec if repeat); returns tag (never 0) */
+int UAddTimeout P((long millisec, int repeat, EventCallback cb, VOIDSTAR data));
+void URemoveTimeout P((int tag));
+
+/* Dispatch events until the program exits; idle is called after every batch */
+void UEventLoop P((void (*idle)(void)));
@@ -49,6 +49,9 @@
  *------------------------------------------------------------------------
  ** See the file ChangeLog for a revision history.  */
 
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE /* for posix_spawn_file_actions_addchdir_np */
+#endif
 #include "config.h"
 
 #include <stdio.h>
@@ -118,6 +121,20 @@ extern char *getenv();
 #if HAVE_SYS_WAIT_H
 # include <sys/wait.h>
 #endif
+#include <sys/resource.h>
+#if HAVE_SCHED_SETAFFINITY
+# include <sched.h>
+#endif
+
+#if HAVE_SPAWN_H
+# include <spawn.h>
+extern char **environ;
+# if HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCHDIR_NP
+#  define SPAWN_CHDIR 1
+# else
+#  define SPAWN_CHDIR 0 /* engines with a directory must be started the old way */
+# endif
+#endif
 
 #if HAVE_DIRENT_H
 # include <dirent.h>
@@ -420,15 +437,108 @@ HostName ()
 #endif /* not HAVE_GETHOSTNAME */
 }
 
+#define LINE_BUF_SIZE 8192 /* initial size; grows when a line does not fit */
+
+int
+ReadLines (InputSourceRef isr, int fd, LineBuffer *lb, InputCallback func, VOIDSTAR closure)
+{   // [HGM] input: read what is available from fd, and pass all complete lines to func, in place.
+    // The buffer is only compacted when its free tail gets small, so most data is never copied,
+    // and it is doubled when a single line does not fit, rather than breaking that line.
+    int count;
+    char *p, *q, c;
+
+    if(lb->buf == NULL) lb->buf = malloc((lb->size = LINE_BUF_SIZE) + 1);
+    if(lb->size - lb->end < LINE_BUF_SIZE/4) {
+	if(lb->start > 0) { // move incomplete line to start
+	    memmove(lb->buf, lb->buf + lb->start, lb->end - lb->start);
+	    lb->end -= lb->start; lb->start = 0;
+	}
+	if(lb->size - lb->end < LINE_BUF_SIZE/4) lb->buf = realloc(lb->buf, (lb->size *= 2) + 1);
+    }
+    count = read(fd, lb->buf + lb->end, lb->size - lb->end);
+    if (count <= 0) {
+	func(isr, closure, lb->buf, count, count ? errno : 0);
+	return count;
+    }
+    lb->end += count;
+    p = lb->buf + lb->start;
+    while ((q = memchr(p, '\n', lb->buf + lb->end - p))) {
+	c = *++q; *q = NULLCHAR; // terminate line after its linefeed, so callbacks can treat it as string
+	func(isr, closure, p, q - p, 0);
+	*q = c; p = q;
+    }
+    lb->start = p - lb->buf;
+    if(lb->start == lb->end) lb->start = lb->end = 0; // all consumed; start over at the beginning
+    return count;
+}
+
+char *
+HelperProgram ()
+{   // [HGM] concurrency: executable to start helper instances with. That is the display-less xboard-nogui
+    // installed next to us, if there is one, so that the helpers do not need a display; otherwise ourselves.
+    static char path[MSG_SIZ];
+    int n = readlink("/proc/self/exe", path, MSG_SIZ-7);
+
+    if(n <= 0) return programName; // no /proc; hope it is in the PATH
+    path[n] = NULLCHAR;
+    if(n > 6 && !strcmp(path + n - 6, "-nogui")) return path;
+    strcat(path, "-nogui");
+    if(access(path, X_OK) == 0) return path;
+    path[n] = NULLCHAR;
+    return path;
+}
+
+static char *childAffinity;
+
+void
+SetChildAffinity (char *cpuList)
+{   // [HGM] affinity: CPUs for the next child process to run on (NULL = no restriction)
+    childAffinity = cpuList;
+}
+
+int
+NumberOfCPUs ()
+{
+    return sysconf(_SC_NPROCESSORS_ONLN);
+}
+
+#if HAVE_SCHED_SETAFFINITY
+static int
+PinSelf (char *cpuList, cpu_set_t *saved)
+{   // [HGM] affinity: temporarily restrict ourselves to the given CPUs, so that a child we start inherits this
+    cpu_set_t mask;
+    int from, to, n, cpus = 0;
+    char *p = cpuList;
+
+    if(p == NULL || *p == NULLCHAR) return FALSE;
+    CPU_ZERO(&mask);
+    while(sscanf(p, "%d%n", &from, &n) == 1) {
+	p += n; to = from;
+	if(*p == '-' && sscanf(p+1, "%d%n", &to, &n) == 1) p += n+1;
+	for(; from <= to && from < CPU_SETSIZE; from++) if(from >= 0) CPU_SET(from, &mask), cpus++;
+	if(*p != ',') break;
+	p++;
+    }
+    if(!cpus || sched_getaffinity(0, sizeof(cpu_set_t), saved)) return FALSE;
+    if(sched_setaffinity(0, sizeof(cpu_set_t), &mask)) {
+	if(appData.debugMode) fprintf(debugFP, "cannot set affinity %s\n", cpuList);
+	return FALSE;
+    }
+    return TRUE;
+}
+#endif
 
 int
 StartChildProcess (char *cmdLine, char *dir, ProcRef *pr)
 {
     char *argv[64], *p;
-    int i, pid;
+    int i, pid, pinned = FALSE;
     int to_prog[2], from_prog[2];
     ChildProc *cp;
     char buf[MSG_SIZ];
+#if HAVE_SCHED_SETAFFINITY
+    cpu_set_t saved;
+#endif
 
     if (appData.debugMode) {
 	fprintf(debugFP, "StartChildProcess (dir=\"%s\") %s\n",dir, cmdLine);
@@ -452,8 +562,42 @@ StartChildProcess (char *cmdLine, char *dir, ProcRef *pr)
     }
     argv[i] = NULL;
 
+#if HAVE_SCHED_SETAFFINITY
+    pinned = PinSelf(childAffinity, &saved);
+#endif
+    childAffinity = NULL; // only applies to one child
+
     SetUpChildIO(to_prog, from_prog);
 
+#if HAVE_SPAWN_H && HAVE_POSIX_SPAWNP
+    if ((dir[0] == NULLCHAR || SPAWN_CHDIR) && !appData.niceEngines) { // (spawn attributes cannot renice)
+	// [HGM] spawn: do not duplicate the entire GUI process just to exec the engine in it
+	posix_spawn_file_actions_t actions;
+	int err;
+
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_addclose(&actions, to_prog[1]);
+	posix_spawn_file_actions_addclose(&actions, from_prog[0]);
+	posix_spawn_file_actions_adddup2(&actions, to_prog[0], 0);
+	posix_spawn_file_actions_adddup2(&actions, from_prog[1], 1);
+	if(to_prog[0] >= 2) posix_spawn_file_actions_addclose(&actions, to_prog[0]);
+	if(from_prog[1] > 2) posix_spawn_file_actions_addclose(&actions, from_prog[1]);
+	posix_spawn_file_actions_adddup2(&actions, 1, 2); /* force stderr to the pipe */
+#if HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCHDIR_NP
+	if(dir[0] != NULLCHAR) posix_spawn_file_actions_addchdir_np(&actions, dir);
+#endif
+	err = posix_spawnp(&pid, argv[0], &actions, NULL, argv, environ);
+	posix_spawn_file_actions_destroy(&actions);
+	if(err) {
+	    close(to_prog[0]); close(to_prog[1]);
+	    close(from_prog[0]); close(from_prog[1]);
+#if HAVE_SCHED_SETAFFINITY
+	    if(pinned) sched_setaffinity(0, sizeof(cpu_set_t), &saved);
+#endif
+	    return err;
+	}
+    } else
+#endif
     if ((pid = fork()) == 0) {
 	/* Child process */
 	// [HGM] PSWBTM: made order resistant against case where fd of created pipe was 0 or 1
@@ -481,6 +625,9 @@ StartChildProcess (char *cmdLine, char *dir, ProcRef *pr)
     }
 
     /* Parent process */
+#if HAVE_SCHED_SETAFFINITY
+    if(pinned) sched_setaffinity(0, sizeof(cpu_set_t), &saved); // child has inherited it, so we can be free again
+#endif
     close(to_prog[0]);
     close(from_prog[1]);
 
@@ -500,20 +647,33 @@ AlarmCallBack (int n)
     return;
 }
 
+static void
+RUsage (ChildProc *cp, struct rusage *ru)
+{   // [HGM] cpu: remember what the reaped process used
+    cp->usage.userTime = 1000*ru->ru_utime.tv_sec + ru->ru_utime.tv_usec/1000;
+    cp->usage.sysTime  = 1000*ru->ru_stime.tv_sec + ru->ru_stime.tv_usec/1000;
+    cp->usage.maxRSS = ru->ru_maxrss;
+    cp->usage.volSwitches = ru->ru_nvcsw;
+    cp->usage.involSwitches = ru->ru_nivcsw;
+    cp->reaped = TRUE;
+}
+
 void
 DestroyChildProcess (ProcRef pr, int signalType)
 {
     ChildProc *cp = (ChildProc *) pr;
+    struct rusage ru;
 
     if (cp->kind != CPReal) return;
     cp->kind = CPNone;
     if (signalType == 10) { // [HGM] kill: if it does not terminate in 3 sec, kill
 	signal(SIGALRM, AlarmCallBack);
 	alarm(3);
-	if(wait((int *) 0) == -1) { // process does not terminate on its own accord
+	if(wait4(cp->pid, NULL, 0, &ru) == -1) { // process does not terminate on its own accord
 	    kill(cp->pid, SIGKILL); // kill it forcefully
-	    wait((int *) 0);        // and wait again
-	}
+	    if(wait4(cp->pid, NULL, 0, &ru) != -1) RUsage(cp, &ru); // and wait again
+	} else RUsage(cp, &ru);
+	alarm(0);
     } else {
 	if (signalType) {
 	    kill(cp->pid, signalType == 9 ? SIGKILL : SIGTERM); // [HGM] kill: use hard kill if so requested
@@ -521,12 +681,43 @@ DestroyChildProcess (ProcRef pr, int signalType)
 	/* Process is exiting either because of the kill or because of
 	   a quit command sent by the backend; either way, wait for it to die.
 	*/
-	wait((int *) 0);
+	if(wait4(cp->pid, NULL, 0, &ru) != -1) RUsage(cp, &ru);
     }
     close(cp->fdFrom);
     close(cp->fdTo);
 }
 
+int
+GetProcessUsage (ProcRef pr, ProcUsage *usage)
+{   // [HGM] cpu: resources used so far by a running child (from /proc), or in total by one we reaped
+    ChildProc *cp = (ChildProc *) pr;
+    char buf[MSG_SIZ], *p;
+    long ticks = sysconf(_SC_CLK_TCK), v;
+    unsigned long utime, stime;
+    FILE *f;
+
+    if (cp == NULL) return -1;
+    if (cp->reaped) { *usage = cp->usage; return 0; }
+    if (cp->kind != CPReal) return -1;
+    snprintf(buf, MSG_SIZ, "/proc/%d/stat", cp->pid);
+    if ((f = fopen(buf, "r")) == NULL) return -1;
+    p = fgets(buf, MSG_SIZ, f) ? strrchr(buf, ')') : NULL; // command name could contain spaces
+    fclose(f);
+    if (p == NULL || sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2) return -1;
+    usage->userTime = utime * 1000 / ticks;
+    usage->sysTime  = stime * 1000 / ticks;
+    usage->maxRSS = usage->volSwitches = usage->involSwitches = 0;
+    snprintf(buf, MSG_SIZ, "/proc/%d/status", cp->pid);
+    if ((f = fopen(buf, "r")) == NULL) return 0;
+    while (fgets(buf, MSG_SIZ, f)) {
+	if (sscanf(buf, "VmHWM: %ld", &v) == 1) usage->maxRSS = v; else
+	if (sscanf(buf, "voluntary_ctxt_switches: %ld", &v) == 1) usage->volSwitches = v; else
+	if (sscanf(buf, "nonvoluntary_ctxt_switches: %ld", &v) == 1) usage->involSwitches = v;
+    }
+    fclose(f);
+    return 0;
+}
+
 void
 InterruptChildProcess (ProcRef pr)
 {
@@ -65,11 +65,19 @@ typedef struct {
     CPKind kind;
     int pid;
     int fdTo, fdFrom;
+    int reaped;          /* [HGM] cpu: usage below was collected when the process was waited for */
+    ProcUsage usage;
 } ChildProc;
 
+typedef struct { // [HGM] input: unconsumed input of a line-by-line input source is buf[start..end)
+    char *buf;
+    int size, start, end;
+} LineBuffer;
+
 extern char *oldICSInteractionTitle;
 
 char *ExpandPathName P((char *path));
 int  MySearchPath P((char *installDir, char *name, char *fullname));
 int  MyGetFullPathName P((char *name, char *fullname));
 void PlaySoundForColor P((ColorClass cc));
+int  ReadLines P((InputSourceRef isr, int fd, LineBuffer *lb, InputCallback func, VOIDSTAR closure));
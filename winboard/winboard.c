@@ -8813,6 +8813,16 @@ HostName()
   return buf;
 }
 
+char *
+HelperProgram()
+{ // [HGM] concurrency: helpers are copies of ourselves
+  static char buf[MSG_SIZ];
+
+  if (!GetModuleFileName(NULL, buf, MSG_SIZ))
+    safeStrCpy(buf, "winboard.exe", sizeof(buf)/sizeof(buf[0]) );
+  return buf;
+}
+
 
 int
 ClockTimerRunning()
@@ -9219,6 +9229,33 @@ DestroyChildProcess(ProcRef pr, int/*boolean*/ signal)
   free(cp);
 }
 
+int
+GetProcessUsage(ProcRef pr, ProcUsage *usage)
+{ /* [HGM] cpu: only times are available without psapi */
+  ChildProc *cp = (ChildProc *) pr;
+  FILETIME creation, exit, kernel, user;
+
+  if (cp == NULL || cp->kind != CPReal) return -1;
+  if (!GetProcessTimes(cp->hProcess, &creation, &exit, &kernel, &user)) return -1;
+  usage->userTime = (((ULONGLONG) user.dwHighDateTime << 32) + user.dwLowDateTime) / 10000;
+  usage->sysTime = (((ULONGLONG) kernel.dwHighDateTime << 32) + kernel.dwLowDateTime) / 10000;
+  usage->maxRSS = usage->volSwitches = usage->involSwitches = 0;
+  return 0;
+}
+
+void
+SetChildAffinity(char *cpuList)
+{ /* [HGM] affinity: not implemented; engines run on all CPUs */
+}
+
+int
+NumberOfCPUs()
+{
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwNumberOfProcessors;
+}
+
 void
 InterruptChildProcess(ProcRef pr)
 {
@@ -10036,3 +10073,8 @@ ActivateTheme (int new)
    InitDrawingSizes(-2, 0);
    InvalidateRect(hwndMain, NULL, TRUE);
 }
+
+void
+TourneyDashboardUpdate ()
+{   // [HGM] dashboard: WinBoard has no tourney dashboard window (yet)
+}
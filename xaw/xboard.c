@@ -2442,7 +2442,7 @@ typedef struct {
     CPKind kind;
     int fd;
     int lineByLine;
-    char *unused;
+    LineBuffer lines;
     InputCallback func;
     XtInputId xid;
     char buf[INPUT_SOURCE_BUF_SIZE];
@@ -2455,29 +2455,9 @@ DoInputCallback (caddr_t closure, int *source, XtInputId *xid)
     InputSource *is = (InputSource *) closure;
     int count;
     int error;
-    char *p, *q;
 
     if (is->lineByLine) {
-	count = read(is->fd, is->unused,
-		     INPUT_SOURCE_BUF_SIZE - (is->unused - is->buf));
-	if (count <= 0) {
-	    (is->func)(is, is->closure, is->buf, count, count ? errno : 0);
-	    return;
-	}
-	is->unused += count;
-	p = is->buf;
-	while (p < is->unused) {
-	    q = memchr(p, '\n', is->unused - p);
-	    if (q == NULL) break;
-	    q++;
-	    (is->func)(is, is->closure, p, q - p, 0);
-	    p = q;
-	}
-	q = is->buf;
-	while (p < is->unused) {
-	    *q++ = *p++;
-	}
-	is->unused = q;
+	ReadLines(is, is->fd, &is->lines, is->func, is->closure);
     } else {
 	count = read(is->fd, is->buf, INPUT_SOURCE_BUF_SIZE);
 	if (count == -1)
@@ -2504,10 +2484,6 @@ AddInputSource (ProcRef pr, int lineByLine, InputCallback func, VOIDSTAR closure
 	is->kind = cp->kind;
 	is->fd = cp->fdFrom;
     }
-    if (lineByLine) {
-	is->unused = is->buf;
-    }
-
     is->xid = XtAppAddInput(appContext, is->fd,
 			    (XtPointer) (XtInputReadMask),
 			    (XtInputCallbackProc) DoInputCallback,